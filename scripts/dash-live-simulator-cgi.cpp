@@ -6,6 +6,12 @@
 #include <sstream>
 #include <thread>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional> // hash
+#include <map>
+#include <random>
+#include <set>
 
 static auto const SegmentDuration = 1000LL;
 static auto const FragmentDuration = 200LL;
@@ -13,10 +19,161 @@ static auto const FragmentsPerSegment = SegmentDuration / FragmentDuration;
 
 using namespace std;
 
+// Virtual clock, running SIMULATOR_SPEED times faster than the real one,
+// from SIMULATOR_EPOCH (UTC time in milliseconds, usually the server start time).
+// e.g with a speed of 100, an hour of live streaming is served in 36s.
+// Each request runs in its own process: the clock can't keep any state.
+struct VirtualClock
+{
+  VirtualClock()
+  {
+    auto const speedEnv = getenv("SIMULATOR_SPEED");
+    auto const epochEnv = getenv("SIMULATOR_EPOCH");
+
+    if(speedEnv && epochEnv)
+    {
+      speed = atof(speedEnv);
+      epoch = atoll(epochEnv);
+    }
+
+    if(speed <= 0)
+      speed = 1.0;
+  }
+
+  // in milliseconds
+  int64_t now() const
+  {
+    auto const real = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    return epoch + int64_t((real - epoch) * speed);
+  }
+
+  void sleep(int64_t virtualMs) const
+  {
+    this_thread::sleep_for(chrono::microseconds(int64_t(virtualMs * 1000 / speed)));
+  }
+
+  double speed = 1.0;
+  int64_t epoch = 0;
+};
+
+// Network impairments, set from the environment (see scripts/network-profiles):
+// SIMULATOR_BANDWIDTH: cap, in kbit/s, of each response. 0 for no cap.
+// SIMULATOR_RTT: delay, in ms, before each response.
+// SIMULATOR_JITTER: random extra delay, in ms, up to this value.
+// SIMULATOR_SEED: seed of the jitter. The jitter of a given URL is the same from a run to the other.
+// SIMULATOR_STALLS: list of 'segment:ms', e.g "10:2000,25:500": the segment stalls after its first fragment.
+// SIMULATOR_DROPS: list of segment numbers, e.g "12,30": the connection closes after their first fragment.
+// SIMULATOR_IMPAIRMENT_PERIOD: if set, the segment numbers of the stalls and drops are modulo this period,
+// e.g with 30, "12" drops the segments 12, 42, 72, etc.
+// These delays are in real time, whatever the speed of the virtual clock.
+struct NetworkConditions
+{
+  NetworkConditions()
+  {
+    auto getInt = [] (const char* name) { auto val = getenv(name); return val ? atoll(val) : 0LL; };
+
+    bandwidth = getInt("SIMULATOR_BANDWIDTH") * 1000;
+    rtt = getInt("SIMULATOR_RTT");
+    jitter = getInt("SIMULATOR_JITTER");
+    seed = getInt("SIMULATOR_SEED");
+    period = getInt("SIMULATOR_IMPAIRMENT_PERIOD");
+
+    if(auto val = getenv("SIMULATOR_STALLS"))
+    {
+      stringstream ss(val);
+      string item;
+
+      while(getline(ss, item, ','))
+      {
+        long long number = 0, duration = 0;
+
+        if(sscanf(item.c_str(), "%lld:%lld", &number, &duration) == 2)
+          stalls[number] = duration;
+      }
+    }
+
+    if(auto val = getenv("SIMULATOR_DROPS"))
+    {
+      stringstream ss(val);
+      string item;
+
+      while(getline(ss, item, ','))
+        drops.insert(atoll(item.c_str()));
+    }
+  }
+
+  int64_t getStall(long long segmentNumber) const
+  {
+    auto i = stalls.find(period ? segmentNumber % period : segmentNumber);
+    return i == stalls.end() ? 0 : i->second;
+  }
+
+  bool isDropped(long long segmentNumber) const
+  {
+    return drops.count(period ? segmentNumber % period : segmentNumber);
+  }
+
+  // before sending the response headers
+  void delayResponse(string const& url) const
+  {
+    auto delay = rtt;
+
+    if(jitter > 0)
+    {
+      mt19937_64 rng(seed ^ hash<string>()(url));
+      delay += uniform_int_distribution<int64_t>(0, jitter)(rng);
+    }
+
+    this_thread::sleep_for(chrono::milliseconds(delay));
+  }
+
+  // Writes to the client, no faster than the bandwidth cap
+  void write(const void* ptr, size_t len)
+  {
+    if(!bandwidth)
+    {
+      fwrite(ptr, 1, len, stdout);
+      return;
+    }
+
+    if(!sent)
+      start = chrono::steady_clock::now();
+
+    auto const MaxBurst = size_t(1500);
+    auto p = (const uint8_t*)ptr;
+
+    while(len > 0)
+    {
+      auto const n = min(len, MaxBurst);
+      fwrite(p, 1, n, stdout);
+      fflush(stdout);
+      p += n;
+      len -= n;
+      sent += n;
+      this_thread::sleep_until(start + chrono::microseconds(sent * 8 * 1000000 / bandwidth));
+    }
+  }
+
+  int64_t bandwidth = 0; // in bits per second
+  int64_t rtt = 0;
+  int64_t jitter = 0;
+  uint64_t seed = 0;
+  map<long long, int64_t> stalls; // segment number -> duration in ms
+  set<long long> drops;
+
+  long long period = 0;
+
+  int64_t sent = 0; // in bytes
+  chrono::steady_clock::time_point start;
+};
+
+static NetworkConditions g_network;
+
 struct HttpRequest
 {
   string method; // e.g: PUT, POST, GET
   string url; // e.g: /toto/dash.mp4
+  map<string, string> headers; // lowercase names
 };
 
 string readLine()
@@ -52,6 +209,19 @@ HttpRequest parseRequest()
 
     if(line.empty())
       break;
+
+    auto const colon = line.find(':');
+
+    if(colon == string::npos)
+      continue;
+
+    auto name = line.substr(0, colon);
+
+    for(auto& c : name)
+      c = tolower(c);
+
+    auto const value = line.find_first_not_of(' ', colon + 1);
+    r.headers[name] = value == string::npos ? "" : line.substr(value);
   }
 
   return r;
@@ -76,6 +246,88 @@ static const char mpd[] = R"(<?xml version="1.0" encoding="utf-8"?>
 </MPD>
 )";
 
+// Many-tile variant: one adaptation set per tile, laid out on a grid (SRD),
+// with 'qualities' representations each (id: tile + 100 * quality, from 1).
+// All the fragments start with a SAP, so a switch could occur at any fragment.
+// The tiles share the same init segment.
+static string makeRepresentations(int tileId, int qualities)
+{
+  string r;
+
+  for(int q = 0; q < qualities; ++q)
+  {
+    char rep[256];
+    snprintf(rep, sizeof rep, R"(      <Representation bandwidth="%d" codecs="cwi1" id="%d" />
+)", 300000 * (q + 1), tileId + 100 * q);
+    r += rep;
+  }
+
+  return r;
+}
+
+string makeTiledMpd(int tiles, int qualities)
+{
+  int cols = 1;
+
+  while(cols * cols < tiles)
+    ++cols;
+
+  auto const rows = (tiles + cols - 1) / cols;
+
+  string r = R"(<?xml version="1.0" encoding="utf-8"?>
+<MPD
+  availabilityStartTime="1970-01-01T00:00:00Z"
+  maxSegmentDuration="PT2S"
+  timeShiftBufferDepth="PT5M"
+  type="dynamic">
+  <Period id="p0" start="PT0S">
+)";
+
+  for(int i = 0; i < tiles; ++i)
+  {
+    char as[4096];
+    snprintf(as, sizeof as, R"(    <AdaptationSet contentType="video" mimeType="video/mp4" segmentAlignment="true" startWithSAP="1">
+      <SupplementalProperty schemeIdUri="urn:mpeg:dash:srd:2014" value="0,%d,%d,1,1,%d,%d"/>
+      <SegmentTemplate
+        timescale="1000" duration="1000"
+        initialization="init.mp4"
+        media="$RepresentationID$-$Number$.m4s"
+        startNumber="0" />
+%s    </AdaptationSet>
+)", i % cols, i / cols, cols, rows, makeRepresentations(i + 1, qualities).c_str());
+    r += as;
+  }
+
+  r += R"(  </Period>
+</MPD>
+)";
+
+  return r;
+}
+
+// SIMULATOR_MPD_UPDATE_PERIOD (in ms) makes the clients refresh the manifest.
+// The manifest never changes: a refresh only costs the transfer and the parsing.
+static string withUpdatePeriod(string mpd, long long periodInMs)
+{
+  if(periodInMs <= 0)
+    return mpd;
+
+  char attribute[128];
+  snprintf(attribute, sizeof attribute, "\n  minimumUpdatePeriod=\"PT%lld.%03lldS\"", periodInMs / 1000, periodInMs % 1000);
+
+  auto const pos = mpd.find("type=\"dynamic\"");
+  mpd.insert(pos + strlen("type=\"dynamic\""), attribute);
+  return mpd;
+}
+
+// Strong validator of a response body, for conditional requests (If-None-Match).
+static string makeEtag(string const& body)
+{
+  char etag[32];
+  snprintf(etag, sizeof etag, "\"%016llx\"", (unsigned long long)hash<string>()(body));
+  return etag;
+}
+
 static const uint8_t initChunk[] =
 {
   0x00, 0x00, 0x00, 0x18, 0x66, 0x74, 0x79, 0x70, 0x69, 0x73, 0x6f, 0x6d,
@@ -225,38 +477,70 @@ std::vector<uint8_t> getFragment(int64_t index)
 
 void sendLine(const char* format, ...)
 {
+  char line[1024];
   va_list args;
   va_start(args, format);
-  vfprintf(stdout, format, args);
+  vsnprintf(line, sizeof line - 2, format, args);
   va_end(args);
-  fprintf(stdout, "\r\n");
+  strcat(line, "\r\n");
+  g_network.write(line, strlen(line));
 }
 
 void sendChunk(const void* ptr, size_t len)
 {
   sendLine("%X", len);
   if(ptr)
-    fwrite(ptr, 1, len, stdout);
+    g_network.write(ptr, len);
   sendLine("");
 }
 
 int main()
 {
   long long reqNumber = 0;
+  int reqTile = 0;
   auto req = parseRequest();
 
+  // number of tiles, e.g for benchmarking many-tile sessions
+  auto const tilesEnv = getenv("SIMULATOR_TILES");
+  auto const tiles = tilesEnv ? atoi(tilesEnv) : 1;
+
+  // number of representations per tile, e.g for measuring the quality switches
+  auto const qualitiesEnv = getenv("SIMULATOR_QUALITIES");
+  auto const qualities = qualitiesEnv ? atoi(qualitiesEnv) : 1;
+
+  VirtualClock const clock;
+
   if(req.method != "GET")
   {
     fprintf(stderr, "Unhandled method '%s'", req.method.c_str());
     return 1;
   }
 
+  g_network.delayResponse(req.url);
+
   if(req.url == "/latency.mpd")
   {
+    auto const updatePeriodEnv = getenv("SIMULATOR_MPD_UPDATE_PERIOD");
+    auto const body = withUpdatePeriod(tiles > 1 || qualities > 1 ? makeTiledMpd(tiles, qualities) : string(mpd), updatePeriodEnv ? atoll(updatePeriodEnv) : 0);
+    auto const etag = makeEtag(body);
+    auto const ifNoneMatch = req.headers.find("if-none-match");
+
+    if(ifNoneMatch != req.headers.end() && ifNoneMatch->second == etag)
+    {
+      fprintf(stderr, "[server] MPD not modified\n");
+      sendLine("HTTP/1.1 304 Not Modified");
+      sendLine("ETag: %s", etag.c_str());
+      sendLine("");
+      return 0;
+    }
+
+    fprintf(stderr, "[server] MPD sent: %d bytes\n", (int)body.size());
+
     sendLine("HTTP/1.1 200 OK");
+    sendLine("ETag: %s", etag.c_str());
     sendLine("Transfer-Encoding: chunked");
     sendLine("");
-    sendChunk(mpd, (sizeof mpd) - 1);
+    sendChunk(body.c_str(), body.size());
     sendChunk(nullptr, 0);
   }
   else if(req.url == "/init.mp4")
@@ -267,14 +551,14 @@ int main()
     sendChunk(initChunk, sizeof initChunk);
     sendChunk(nullptr, 0);
   }
-  else if(sscanf(req.url.c_str(), "/%lld.m4s", &reqNumber) == 1)
+  else if(sscanf(req.url.c_str(), "/%d-%lld.m4s", &reqTile, &reqNumber) == 2 || sscanf(req.url.c_str(), "/%lld.m4s", &reqNumber) == 1)
   {
     auto const reqTime = reqNumber * SegmentDuration;
-    auto const currTime = (time(nullptr) * 1000LL);
+    auto const currTime = clock.now();
     auto const deltaTime = reqTime - currTime;
 
     if(deltaTime > 0)
-      this_thread::sleep_for(chrono::milliseconds(deltaTime));
+      clock.sleep(deltaTime);
 
     fprintf(stderr, "\n[server] HTTP-GET segment number: %lld\n", reqNumber);
 
@@ -285,6 +569,22 @@ int main()
     {
       auto fragment = getFragment(reqTime / FragmentDuration + i);
       sendChunk(fragment.data(), fragment.size());
+
+      if(i == 0 && g_network.isDropped(reqNumber))
+      {
+        fprintf(stderr, "[server] Dropping the connection of segment %lld\n", reqNumber);
+        fflush(stdout);
+        return 1;
+      }
+
+      auto const stall = i == 0 ? g_network.getStall(reqNumber) : 0;
+
+      if(stall)
+      {
+        fprintf(stderr, "[server] Stalling segment %lld\n", reqNumber);
+        fflush(stdout);
+        this_thread::sleep_for(chrono::milliseconds(stall));
+      }
     }
     sendChunk(nullptr, 0);
     fprintf(stderr, "[server] Sent %d fragments\n", int(FragmentsPerSegment));
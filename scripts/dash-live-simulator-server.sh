@@ -9,6 +9,26 @@ mkdir -p "$tmpDir"
 
 readonly scriptDir=$(dirname $0)
 g++ $scriptDir/dash-live-simulator-cgi.cpp -o $tmpDir/fake-server-cgi.exe
+# SIMULATOR_SPEED accelerates the simulated time, from now on
+if [ ! -z "${SIMULATOR_SPEED:-}" ] ; then
+  export SIMULATOR_EPOCH=${SIMULATOR_EPOCH:-$(date +%s%3N)}
+fi
+
+# SIMULATOR_PROFILE: network conditions, from scripts/network-profiles (e.g "4g").
+# Variables set in the environment take precedence over the profile.
+if [ ! -z "${SIMULATOR_PROFILE:-}" ] ; then
+  readonly profile=$scriptDir/network-profiles/$SIMULATOR_PROFILE.env
+  while IFS='=' read -r name value ; do
+    case "$name" in
+      ''|\#*) continue ;;
+    esac
+    if [ -z "${!name:-}" ] ; then
+      export "$name=$value"
+    fi
+  done < "$profile"
+  echo "Network profile: $SIMULATOR_PROFILE"
+fi
+
 echo "Server ready on: http://127.0.0.1:9000/latency.mpd"
 tcpserver -D 127.0.0.1 9000 $tmpDir/fake-server-cgi.exe &
 serverPid=$!
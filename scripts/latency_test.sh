@@ -18,6 +18,8 @@ trap "rm -rf $tmpDir ; cleanup" EXIT
 mkdir -p $tmpDir
 
 readonly BIN=$1
+# optional network profile, from scripts/network-profiles
+export SIMULATOR_PROFILE=${2:-${SIMULATOR_PROFILE:-}}
 
 function main
 {
@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+# Compares the time to first frame of the contribution feeds (libav path),
+# with the default and the low-latency profiles.
+# The feed comes from a local stand-in encoder sending data/test.mp4 as MPEG-TS.
+set -euo pipefail
+
+export LD_LIBRARY_PATH=$EXTRA/lib${LD_LIBRARY_PATH:+:}${LD_LIBRARY_PATH:-}
+
+senderPid=""
+
+function cleanup
+{
+  if [ ! -z "$senderPid" ] ;  then
+    kill $senderPid || true
+  fi
+}
+
+readonly tmpDir=/tmp/libav-ttff-test-$$
+trap "rm -rf $tmpDir ; cleanup" EXIT
+mkdir -p $tmpDir
+
+readonly BIN=$1
+readonly PORT=9100
+
+function main
+{
+  export SIGNALS_SMD_PATH=$BIN
+
+  g++ -O2 -Isrc src/main_ts_sender.cpp src/mp4_index.cpp src/annexb.cpp src/filemap_gnu.cpp \
+    -o $tmpDir/ts_sender.exe
+  g++ src/main_ttff.cpp $BIN/signals-unity-bridge.so \
+    -o $tmpDir/main_ttff.exe
+
+  for protocol in udp tcp ; do
+    for profile in 0 1 ; do
+      $tmpDir/ts_sender.exe data/test.mp4 $protocol $PORT &
+      senderPid=$!
+      sleep 0.5
+
+      $tmpDir/main_ttff.exe "$protocol://127.0.0.1:$PORT" $profile
+
+      kill $senderPid || true
+      wait $senderPid || true
+      senderPid=""
+    done
+  done
+}
+
+main
@@ -0,0 +1,26 @@
+#!/usr/bin/env bash
+# Usage: lifecycle_bench.sh <bin dir> [max handle count] [url]
+# Offline: plays a local file by default.
+set -euo pipefail
+
+export LD_LIBRARY_PATH=$EXTRA/lib${LD_LIBRARY_PATH:+:}${LD_LIBRARY_PATH:-}
+
+readonly tmpDir=/tmp/lifecycle-bench-$$
+trap "rm -rf $tmpDir" EXIT
+mkdir -p $tmpDir
+
+readonly BIN=$1
+readonly MAX_HANDLES=${2:-64}
+readonly URL=${3:-data/test.mp4}
+
+function main
+{
+  export SIGNALS_SMD_PATH=$BIN
+
+  g++ -O2 src/main_lifecycle_bench.cpp $BIN/signals-unity-bridge.so \
+    -lpthread -o $tmpDir/main_lifecycle_bench.exe
+
+  $tmpDir/main_lifecycle_bench.exe "$URL" $MAX_HANDLES
+}
+
+main
@@ -0,0 +1,46 @@
+#!/usr/bin/env bash
+# Usage: mpd_refresh_test.sh <bin dir> [tile count] [duration in seconds] [update period in ms]
+# Measures the manifest refreshes of a many-tile live stream, on both ends:
+# the client download timings, and the simulator log (full responses vs 304 Not Modified).
+set -euo pipefail
+
+export LD_LIBRARY_PATH=$EXTRA/lib${LD_LIBRARY_PATH:+:}${LD_LIBRARY_PATH:-}
+
+readonly scriptDir=$(dirname $0)
+pids=""
+
+function cleanup
+{
+  if [ ! -z "$pids" ] ;  then
+    kill $pids
+  fi
+}
+
+readonly tmpDir=/tmp/mpd-refresh-test-$$
+trap "rm -rf $tmpDir ; cleanup" EXIT
+mkdir -p $tmpDir
+
+readonly BIN=$1
+readonly TILES=${2:-64}
+readonly DURATION=${3:-10}
+readonly UPDATE_PERIOD=${4:-1000}
+
+function main
+{
+  export SIGNALS_SMD_PATH=$BIN
+
+  g++ -O2 src/main_mpd_refresh.cpp $BIN/signals-unity-bridge.so \
+    -o $tmpDir/main_mpd_refresh.exe
+
+  SIMULATOR_TILES=$TILES SIMULATOR_MPD_UPDATE_PERIOD=$UPDATE_PERIOD \
+    $scriptDir/dash-live-simulator-server.sh 2> $tmpDir/server.log &
+  pids+=" $!"
+
+  sleep 1.0
+  $tmpDir/main_mpd_refresh.exe "http://127.0.0.1:9000/latency.mpd" $DURATION
+
+  echo "Origin: $(grep -c 'MPD sent' $tmpDir/server.log || true) full manifests," \
+    "$(grep -c 'MPD not modified' $tmpDir/server.log || true) not modified"
+}
+
+main
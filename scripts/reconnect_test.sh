@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+# Kills and restarts the live simulator while playing it:
+# the session must resume by itself.
+set -euo pipefail
+
+export LD_LIBRARY_PATH=$EXTRA/lib${LD_LIBRARY_PATH:+:}${LD_LIBRARY_PATH:-}
+
+readonly scriptDir=$(dirname $0)
+serverPid=""
+
+function cleanup
+{
+  if [ ! -z "$serverPid" ] ;  then
+    kill $serverPid || true
+  fi
+}
+
+readonly tmpDir=/tmp/reconnect-test-$$
+trap "rm -rf $tmpDir ; cleanup" EXIT
+mkdir -p $tmpDir
+
+readonly BIN=$1
+
+function main
+{
+  export SIGNALS_SMD_PATH=$BIN
+
+  g++ src/main_reconnect.cpp $BIN/signals-unity-bridge.so \
+    -o $tmpDir/main_reconnect.exe
+
+  $scriptDir/dash-live-simulator-server.sh &
+  serverPid=$!
+  sleep 1.0
+
+  $tmpDir/main_reconnect.exe "http://127.0.0.1:9000/latency.mpd" &
+  local clientPid=$!
+
+  sleep 4.0
+  echo "Stopping the origin"
+  kill $serverPid
+  wait $serverPid || true
+  serverPid=""
+
+  sleep 4.0
+  echo "Restarting the origin"
+  $scriptDir/dash-live-simulator-server.sh &
+  serverPid=$!
+
+  wait $clientPid
+}
+
+main
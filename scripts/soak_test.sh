@@ -0,0 +1,45 @@
+#!/usr/bin/env bash
+# Plays the live simulator with an accelerated clock for a long time,
+# creating and destroying the sessions and switching the qualities:
+# the resources (RSS, file descriptors, threads, queues) must not grow.
+# Usage: soak_test.sh <bin> [duration in seconds] [speed factor]
+set -euo pipefail
+
+export LD_LIBRARY_PATH=$EXTRA/lib${LD_LIBRARY_PATH:+:}${LD_LIBRARY_PATH:-}
+
+readonly scriptDir=$(dirname $0)
+serverPid=""
+
+function cleanup
+{
+  if [ ! -z "$serverPid" ] ;  then
+    kill $serverPid || true
+  fi
+}
+
+readonly tmpDir=/tmp/soak-test-$$
+trap "rm -rf $tmpDir ; cleanup" EXIT
+mkdir -p $tmpDir
+
+readonly BIN=$1
+readonly DURATION=${2:-600}
+readonly SPEED=${3:-100}
+
+function main
+{
+  export SIGNALS_SMD_PATH=$BIN
+
+  g++ -O2 -Isrc src/soak.cpp src/dynlib_gnu.cpp -ldl \
+    -o $tmpDir/soak.exe
+
+  # one simulated day every ~15 minutes with the default speed
+  SIMULATOR_SPEED=$SPEED SIMULATOR_TILES=${SIMULATOR_TILES:-4} \
+    $scriptDir/dash-live-simulator-server.sh &
+  serverPid=$!
+  sleep 1.0
+
+  $tmpDir/soak.exe $BIN/signals-unity-bridge.so "http://127.0.0.1:9000/latency.mpd" $DURATION 30 \
+    | tee soak.csv
+}
+
+main
@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+# Usage: threading_bench.sh <bin dir> [tile count] [duration in seconds per mode]
+set -euo pipefail
+
+export LD_LIBRARY_PATH=$EXTRA/lib${LD_LIBRARY_PATH:+:}${LD_LIBRARY_PATH:-}
+
+readonly scriptDir=$(dirname $0)
+pids=""
+
+function cleanup
+{
+  if [ ! -z "$pids" ] ;  then
+    kill $pids
+  fi
+}
+
+readonly tmpDir=/tmp/threading-bench-$$
+trap "rm -rf $tmpDir ; cleanup" EXIT
+mkdir -p $tmpDir
+
+readonly BIN=$1
+readonly TILES=${2:-16}
+readonly DURATION=${3:-10}
+
+function main
+{
+  export SIGNALS_SMD_PATH=$BIN
+
+  g++ -O2 src/main_threading_bench.cpp $BIN/signals-unity-bridge.so \
+    -o $tmpDir/main_threading_bench.exe
+
+  SIMULATOR_TILES=$TILES $scriptDir/dash-live-simulator-server.sh &
+  pids+=" $!"
+
+  sleep 1.0
+  $tmpDir/main_threading_bench.exe "http://127.0.0.1:9000/latency.mpd" $DURATION
+}
+
+main
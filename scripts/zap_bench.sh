@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+# Usage: zap_bench.sh <bin dir> [zap count] [url A] [url B]
+# Offline: switches between local files by default.
+set -euo pipefail
+
+export LD_LIBRARY_PATH=$EXTRA/lib${LD_LIBRARY_PATH:+:}${LD_LIBRARY_PATH:-}
+
+readonly tmpDir=/tmp/zap-bench-$$
+trap "rm -rf $tmpDir" EXIT
+mkdir -p $tmpDir
+
+readonly BIN=$1
+readonly ZAPS=${2:-20}
+readonly URL_A=${3:-data/test.mp4}
+readonly URL_B=${4:-$URL_A}
+
+function main
+{
+  export SIGNALS_SMD_PATH=$BIN
+
+  g++ -O2 src/main_zap_bench.cpp $BIN/signals-unity-bridge.so \
+    -lpthread -o $tmpDir/main_zap_bench.exe
+
+  $tmpDir/main_zap_bench.exe "$URL_A" "$URL_B" $ZAPS
+}
+
+main
@@ -0,0 +1,183 @@
+#include "annexb.h"
+#include <cstring> // memcpy, strlen
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+const uint8_t StartCode[] = { 0, 0, 0, 1 };
+
+uint32_t readLength(const uint8_t* p, int lengthSize)
+{
+  uint32_t r = 0;
+
+  for(int i = 0; i < lengthSize; ++i)
+    r = (r << 8) | p[i];
+
+  return r;
+}
+
+struct DsiReader
+{
+  const uint8_t* ptr;
+  size_t len;
+  size_t pos = 0;
+
+  void need(size_t n) const
+  {
+    if(n > len - pos)
+      throw runtime_error("truncated NAL configuration");
+  }
+
+  uint8_t u8()
+  {
+    need(1);
+    return ptr[pos++];
+  }
+
+  uint16_t u16()
+  {
+    auto const hi = u8();
+    return uint16_t((hi << 8) | u8());
+  }
+
+  void skip(size_t n)
+  {
+    need(n);
+    pos += n;
+  }
+
+  void appendNal(vector<uint8_t>& out)
+  {
+    auto const size = u16();
+    need(size);
+    out.insert(out.end(), StartCode, StartCode + sizeof StartCode);
+    out.insert(out.end(), ptr + pos, ptr + pos + size);
+    pos += size;
+  }
+};
+}
+
+NalConfig parseNalConfig(string const& fourcc, const uint8_t* dsi, size_t dsiSize)
+{
+  NalConfig r;
+
+  // no configuration record (version 1): e.g the DSI is already in Annex-B format
+  if(!dsi || !dsiSize || dsi[0] != 1)
+    return r;
+
+  auto startsWith = [&] (const char* prefix) { return fourcc.compare(0, strlen(prefix), prefix) == 0; };
+
+  DsiReader reader { dsi, dsiSize };
+
+  if(startsWith("avc") || startsWith("h264"))
+  {
+    // AVCDecoderConfigurationRecord (ISO/IEC 14496-15, 5.3.3.1)
+    reader.skip(4);
+    r.lengthSize = (reader.u8() & 3) + 1;
+
+    auto const spsCount = reader.u8() & 31;
+
+    for(int i = 0; i < spsCount; ++i)
+      reader.appendNal(r.parameterSets);
+
+    auto const ppsCount = reader.u8();
+
+    for(int i = 0; i < ppsCount; ++i)
+      reader.appendNal(r.parameterSets);
+  }
+  else if(startsWith("hvc") || startsWith("hev") || startsWith("h265"))
+  {
+    // HEVCDecoderConfigurationRecord (ISO/IEC 14496-15, 8.3.3.1)
+    reader.skip(21);
+    r.lengthSize = (reader.u8() & 3) + 1;
+
+    auto const arrayCount = reader.u8();
+
+    for(int i = 0; i < arrayCount; ++i)
+    {
+      reader.skip(1); // NAL unit type
+      auto const nalCount = reader.u16();
+
+      for(int j = 0; j < nalCount; ++j)
+        reader.appendNal(r.parameterSets);
+    }
+  }
+
+  if(r.lengthSize == 3)
+    throw runtime_error("invalid NAL length size");
+
+  return r;
+}
+
+size_t getAnnexBSize(const uint8_t* src, size_t len, int lengthSize)
+{
+  size_t r = 0;
+  size_t pos = 0;
+
+  while(pos < len)
+  {
+    if(len - pos < (size_t)lengthSize)
+      throw runtime_error("truncated NAL unit length");
+
+    auto const nalSize = readLength(src + pos, lengthSize);
+    pos += lengthSize;
+
+    if(nalSize > len - pos)
+      throw runtime_error("truncated NAL unit");
+
+    r += sizeof StartCode + nalSize;
+    pos += nalSize;
+  }
+
+  // with 4-byte prefixes, the start codes take their place: r == len
+  return r;
+}
+
+void copyToAnnexB(uint8_t* dst, const uint8_t* src, size_t len, int lengthSize)
+{
+  // One pass over the payload: bulk copies only,
+  // the per-NAL work is limited to the prefixes.
+  if(lengthSize == 4)
+  {
+    memcpy(dst, src, len);
+
+    size_t pos = 0;
+
+    while(pos < len)
+    {
+      if(len - pos < 4)
+        throw runtime_error("truncated NAL unit length");
+
+      auto const nalSize = readLength(src + pos, 4);
+
+      if(nalSize > len - pos - 4)
+        throw runtime_error("truncated NAL unit");
+
+      memcpy(dst + pos, StartCode, sizeof StartCode);
+      pos += 4 + nalSize;
+    }
+
+    return;
+  }
+
+  size_t pos = 0;
+
+  while(pos < len)
+  {
+    if(len - pos < (size_t)lengthSize)
+      throw runtime_error("truncated NAL unit length");
+
+    auto const nalSize = readLength(src + pos, lengthSize);
+    pos += lengthSize;
+
+    if(nalSize > len - pos)
+      throw runtime_error("truncated NAL unit");
+
+    memcpy(dst, StartCode, sizeof StartCode);
+    memcpy(dst + sizeof StartCode, src + pos, nalSize);
+    dst += sizeof StartCode + nalSize;
+    pos += nalSize;
+  }
+}
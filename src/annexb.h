@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Rewriting of the length-prefixed NAL units of MP4 samples (H.264/H.265)
+// into Annex-B byte streams (start codes), while copying them.
+
+struct NalConfig
+{
+  int lengthSize = 0; // size of the NAL unit length prefixes. 0 if the samples aren't length-prefixed.
+  std::vector<uint8_t> parameterSets; // VPS/SPS/PPS, already in Annex-B format
+};
+
+// Parses an 'avcC' or 'hvcC' payload, depending on the codec (e.g "avc1", "hvc1", "h264").
+// Other codecs, or a DSI which isn't a configuration record, leave 'lengthSize' to zero.
+NalConfig parseNalConfig(std::string const& fourcc, const uint8_t* dsi, size_t dsiSize);
+
+// Size of the Annex-B version of a sample, without the parameter sets.
+// Only the length prefixes are read. Throws if they don't match 'len', as 'copyToAnnexB' would.
+size_t getAnnexBSize(const uint8_t* src, size_t len, int lengthSize);
+
+// Copies a sample into 'dst', replacing the length prefixes with start codes.
+// 'dst' must hold 'getAnnexBSize' bytes.
+void copyToAnnexB(uint8_t* dst, const uint8_t* src, size_t len, int lengthSize);
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+
+// Fixed-size blocks recycled through a free list.
+// The blocks are preallocated on the first request, as their size
+// (e.g of a shared_ptr control block) is only known at this point.
+// Past the preallocated count, new blocks are allocated and kept for reuse.
+struct BlockPool
+{
+  BlockPool(int preallocatedCount_) : preallocatedCount(preallocatedCount_) {}
+
+  ~BlockPool()
+  {
+    while(freeList)
+    {
+      auto next = freeList->next;
+      ::operator delete(freeList);
+      freeList = next;
+    }
+  }
+
+  void* alloc(size_t size)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m);
+
+      if(!blockSize)
+      {
+        blockSize = size < sizeof(Block) ? sizeof(Block) : size;
+
+        for(int i = 0; i < preallocatedCount; ++i)
+          pushFree(::operator new(blockSize));
+      }
+
+      // blocks of another size can't be recycled
+      if(size <= blockSize)
+      {
+        if(freeList)
+        {
+          auto block = freeList;
+          freeList = block->next;
+          return block;
+        }
+
+        ++exhaustions;
+      }
+    }
+
+    ++allocations;
+    return ::operator new(size <= blockSize ? blockSize : size);
+  }
+
+  void free(void* p, size_t size)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m);
+
+      if(size <= blockSize)
+      {
+        pushFree(p);
+        return;
+      }
+    }
+
+    ::operator delete(p);
+  }
+
+  std::atomic<uint64_t> allocations { 0 }; // past the preallocated blocks, including the oversized ones
+  std::atomic<uint64_t> exhaustions { 0 }; // requests finding the free list empty
+
+  private:
+    struct Block
+    {
+      Block* next;
+    };
+
+    void pushFree(void* p)
+    {
+      auto block = (Block*)p;
+      block->next = freeList;
+      freeList = block;
+    }
+
+    int const preallocatedCount;
+    std::mutex m;
+    size_t blockSize = 0; // set by the first request. Protected by 'm'.
+    Block* freeList = nullptr;
+};
+
+// Standard allocator on top of a BlockPool.
+// e.g: std::allocate_shared<T>(BlockAllocator<T>(pool), ...) allocates the object
+// and its control block in one recycled block.
+template<typename T>
+struct BlockAllocator
+{
+  using value_type = T;
+
+  BlockAllocator(std::shared_ptr<BlockPool> pool_) : pool(pool_) {}
+
+  template<typename U>
+  BlockAllocator(BlockAllocator<U> const& other) : pool(other.pool) {}
+
+  T* allocate(size_t n)
+  {
+    return (T*)pool->alloc(n * sizeof(T));
+  }
+
+  void deallocate(T* p, size_t n)
+  {
+    pool->free(p, n * sizeof(T));
+  }
+
+  template<typename U>
+  bool operator == (BlockAllocator<U> const& other) const { return pool == other.pool; }
+
+  template<typename U>
+  bool operator != (BlockAllocator<U> const& other) const { return pool != other.pool; }
+
+  std::shared_ptr<BlockPool> pool;
+};
@@ -0,0 +1,192 @@
+#include "capture.h"
+#include <cinttypes>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+using namespace Modules;
+using namespace std;
+
+CaptureWriter::CaptureWriter(string const& dir)
+  : m_start(chrono::steady_clock::now())
+{
+  m_index = fopen((dir + "/capture.txt").c_str(), "w");
+  m_data = fopen((dir + "/capture.bin").c_str(), "wb");
+
+  if(!m_index || !m_data)
+  {
+    if(m_index)
+      fclose(m_index);
+
+    if(m_data)
+      fclose(m_data);
+
+    throw runtime_error("Can't create the capture files in '" + dir + "'");
+  }
+}
+
+CaptureWriter::~CaptureWriter()
+{
+  fclose(m_index);
+  fclose(m_data);
+}
+
+int64_t CaptureWriter::now() const
+{
+  return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - m_start).count();
+}
+
+int CaptureWriter::beginRequest(int tile, const char* url)
+{
+  unique_lock<mutex> lock(m_mutex);
+  auto const request = m_requests++;
+  fprintf(m_index, "R %d %d %" PRId64 " %s\n", request, tile, now(), url);
+  return request;
+}
+
+void CaptureWriter::addChunk(int request, SpanC data)
+{
+  unique_lock<mutex> lock(m_mutex);
+  fwrite(data.ptr, 1, data.len, m_data);
+  fprintf(m_index, "C %d %" PRId64 " %" PRIu64 " %zu\n", request, now(), m_offset, data.len);
+  m_offset += data.len;
+}
+
+void CaptureWriter::endRequest(int request, bool ok)
+{
+  unique_lock<mutex> lock(m_mutex);
+  fprintf(m_index, "E %d %" PRId64 " %d\n", request, now(), ok ? 1 : 0);
+  fflush(m_index);
+  fflush(m_data);
+}
+
+CaptureReplay::CaptureReplay(string const& dir, double speed)
+  : m_speed(speed)
+{
+  auto index = fopen((dir + "/capture.txt").c_str(), "r");
+
+  if(!index)
+    throw runtime_error("Can't open the capture in '" + dir + "'");
+
+  map<int, pair<int, size_t>> requests; // request -> (tile, index in m_responses[tile])
+  uint64_t dataSize = 0; // needed by the chunks
+  char line[4096];
+
+  while(fgets(line, sizeof line, index))
+  {
+    int request = 0, tile = 0;
+    int64_t time = 0;
+    uint64_t offset = 0;
+    size_t size = 0;
+
+    if(sscanf(line, "R %d %d %" SCNd64, &request, &tile, &time) == 3)
+    {
+      auto& responses = m_responses[tile];
+      requests[request] = { tile, responses.size() };
+      responses.push_back({ time, {} });
+    }
+    else if(sscanf(line, "C %d %" SCNd64 " %" SCNu64 " %zu", &request, &time, &offset, &size) == 4)
+    {
+      auto i = requests.find(request);
+
+      if(i == requests.end())
+      {
+        fclose(index);
+        throw runtime_error("Corrupted capture in '" + dir + "'");
+      }
+
+      m_responses[i->second.first][i->second.second].chunks.push_back({ time, offset, size });
+      dataSize = max<uint64_t>(dataSize, offset + size);
+    }
+  }
+
+  fclose(index);
+
+  // a capture without any data (e.g nothing was received) can't be mapped, and isn't needed
+  if(!dataSize)
+    return;
+
+  m_data = mapFile((dir + "/capture.bin").c_str());
+
+  if(dataSize > m_data->size())
+    throw runtime_error("Corrupted capture in '" + dir + "'");
+}
+
+bool CaptureReplay::waitUntil(chrono::steady_clock::time_point deadline, atomic<bool> const& aborted)
+{
+  // short sleeps, so an abort is honored quickly
+  while(!aborted && chrono::steady_clock::now() < deadline)
+    this_thread::sleep_for(min<chrono::steady_clock::duration>(deadline - chrono::steady_clock::now(), chrono::milliseconds(20)));
+
+  return !aborted;
+}
+
+bool CaptureReplay::serve(int tile, function<void(SpanC)> callback, atomic<bool> const& aborted)
+{
+  Response const* response = nullptr;
+  chrono::steady_clock::time_point start;
+  bool anchoring = false;
+
+  auto toReplayTime = [&] (int64_t captureTime)
+    {
+      return chrono::duration_cast<chrono::steady_clock::duration>(chrono::microseconds(int64_t(captureTime / m_speed)));
+    };
+
+  {
+    unique_lock<mutex> lock(m_mutex);
+    auto& responses = m_responses[tile];
+    auto& served = m_served[tile];
+
+    if(served < responses.size())
+      response = &responses[served++];
+
+    // The replay starts with the first request: its first chunk is delivered right away.
+    if(response && !m_started)
+    {
+      auto const first = response->chunks.empty() ? response->time : response->chunks[0].time;
+      m_start = chrono::steady_clock::now() - (m_speed > 0 ? toReplayTime(first) : chrono::steady_clock::duration::zero());
+      m_started = true;
+      anchoring = true;
+    }
+
+    start = m_start;
+  }
+
+  // end of the capture: the source stalls, as an origin which stopped publishing
+  if(!response)
+  {
+    waitUntil(chrono::steady_clock::time_point::max(), aborted);
+    return false;
+  }
+
+  // A request made later than in the capture shifts its whole response.
+  // The first one sets the timing, instead.
+  auto base = start;
+
+  if(m_speed > 0 && !anchoring)
+  {
+    auto const requested = chrono::steady_clock::now();
+
+    if(!waitUntil(start + toReplayTime(response->time), aborted))
+      return false;
+
+    if(requested > start + toReplayTime(response->time))
+      base = requested - toReplayTime(response->time);
+  }
+
+  for(auto& chunk : response->chunks)
+  {
+    if(m_speed > 0 && !waitUntil(base + toReplayTime(chunk.time), aborted))
+      return false;
+
+    if(aborted)
+      return false;
+
+    if(!chunk.size)
+      continue;
+
+    callback({ m_data->data() + chunk.offset, chunk.size });
+  }
+
+  return true;
+}
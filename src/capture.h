@@ -0,0 +1,85 @@
+#pragma once
+
+#include "lib_media/common/file_puller.hpp"
+#include "filemap.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Capture of the downloads of a session (manifests, init and media segments),
+// with their timings, for replaying the same traffic again and again.
+// A capture directory holds:
+// - 'capture.bin': the received bytes, appended as they come,
+// - 'capture.txt': one line per event, times in microseconds since the start of the capture:
+//     R <request> <tile> <time> <url>     request sent
+//     C <request> <time> <offset> <size>  chunk received, stored at 'offset' in capture.bin
+//     E <request> <time> <ok>             request completed
+
+struct CaptureWriter
+{
+  // 'dir' must exist.
+  CaptureWriter(std::string const& dir);
+  ~CaptureWriter();
+
+  int beginRequest(int tile, const char* url);
+  void addChunk(int request, Modules::SpanC data);
+  void endRequest(int request, bool ok);
+
+  private:
+    int64_t now() const;
+
+    std::chrono::steady_clock::time_point const m_start;
+
+    std::mutex m_mutex; // protects below members
+    FILE* m_index;
+    FILE* m_data;
+    uint64_t m_offset = 0;
+    int m_requests = 0;
+};
+
+// Serves a capture in place of the network, with the original timing or faster,
+// from the first request served: its first chunk is delivered right away.
+// A capture without any data serves responses without data, i.e failed requests.
+// The responses are matched by tile, in request order, rather than by URL:
+// a live session requests different segment numbers from a run to the other.
+struct CaptureReplay
+{
+  // speed: 1.0 for the original timing, 0 for as fast as possible.
+  CaptureReplay(std::string const& dir, double speed);
+
+  // Delivers the next response of this tile. Once the capture of this tile is exhausted, waits for an abort.
+  // Returns false if aborted.
+  bool serve(int tile, std::function<void(Modules::SpanC)> callback, std::atomic<bool> const& aborted);
+
+  private:
+    struct Chunk
+    {
+      int64_t time;
+      uint64_t offset;
+      size_t size;
+    };
+
+    struct Response
+    {
+      int64_t time;
+      std::vector<Chunk> chunks;
+    };
+
+    // returns false if aborted
+    bool waitUntil(std::chrono::steady_clock::time_point deadline, std::atomic<bool> const& aborted);
+
+    double const m_speed;
+    std::unique_ptr<FileMapping> m_data; // null if the capture has no data
+
+    std::mutex m_mutex; // protects below members
+    bool m_started = false;
+    std::chrono::steady_clock::time_point m_start; // maps the capture times, from the first request served
+    std::map<int, std::vector<Response>> m_responses; // per tile, in request order
+    std::map<int, size_t> m_served; // per tile
+};
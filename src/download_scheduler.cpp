@@ -0,0 +1,581 @@
+#include "download_scheduler.h"
+#include "fast_switch.h"
+#include "mp4_index.h"
+#include "tracer.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+
+using namespace Modules;
+using namespace Modules::In;
+using namespace std;
+
+namespace
+{
+auto const MaxRecords = 1024;
+auto const ManifestTile = -1;
+
+// e.g "http://host:port/path/seg.m4s" -> "http://host:port"
+string getOrigin(string const& url)
+{
+  auto const scheme = url.find("://");
+
+  if(scheme == string::npos)
+    return "";
+
+  auto const path = url.find('/', scheme + 3);
+  return url.substr(0, path);
+}
+
+struct ScheduledPuller : IFilePuller
+{
+  ScheduledPuller(DownloadScheduler* scheduler_, int tile_, int firstTile_) : scheduler(scheduler_), tile(tile_), firstTile(firstTile_)
+  {
+    if(!scheduler->registerPuller(this))
+      exitRequested = true;
+  }
+
+  ~ScheduledPuller()
+  {
+    scheduler->unregisterPuller(this);
+  }
+
+  void wget(const char* url, function<void(SpanC)> callback) override
+  {
+    if(auto replay = scheduler->getReplay())
+    {
+      replay->serve(tile, callback, exitRequested);
+      return;
+    }
+
+    auto const enqueued = chrono::steady_clock::now();
+    auto const capture = scheduler->getCapture();
+    auto const request = capture ? capture->beginRequest(tile, url) : 0;
+
+    if(!scheduler->acquire(tile, exitRequested))
+    {
+      if(capture)
+        capture->endRequest(request, false);
+
+      return;
+    }
+
+    auto const granted = chrono::steady_clock::now();
+    traceSpan("net", "queueing", enqueued, granted, tile, url);
+
+    // the manifest puller is kept: it holds the last manifest
+    if(tile == ManifestTile && !manifestPuller)
+      manifestPuller = scheduler->createManifestPuller();
+
+    auto const origin = getOrigin(url);
+    auto puller = tile == ManifestTile ? nullptr : scheduler->takeConnection(origin);
+    auto const transfer = tile == ManifestTile ? manifestPuller.get() : puller.get();
+    setCurrent(transfer);
+
+    size_t bytes = 0;
+    bool ok = false;
+    string manifest;
+
+    // mid-segment switch: the transfer is cut, and the segment goes on from 'switchUrl'
+    auto const fastSwitch = tile != ManifestTile && scheduler->isFastSwitchEnabled();
+    Mp4BoxSplitter splitter;
+    int64_t lastFragment = -1; // decode time of the last forwarded fragment
+    string switchUrl;
+
+    auto finish = [&] ()
+      {
+        setCurrent(nullptr);
+
+        // an interrupted connection isn't reusable
+        if(ok && puller && switchUrl.empty())
+          scheduler->giveConnection(origin, move(puller));
+
+        scheduler->release();
+
+        auto const end = chrono::steady_clock::now();
+        traceSpan("net", "transfer", granted, end, tile, url);
+        scheduler->addRecord({ tile, url, granted - enqueued, end - granted, bytes, ok });
+
+        if(capture)
+          capture->endRequest(request, ok);
+      };
+
+    auto forward = [&] (const uint8_t* data, size_t len)
+      {
+        if(capture)
+          capture->addChunk(request, SpanC { data, len });
+
+        auto const start = chrono::steady_clock::now();
+        callback(SpanC { data, len });
+        traceSpan("net", "chunk", start, chrono::steady_clock::now(), tile);
+      };
+
+    // cuts before the next fragment, once a fragment of this segment went through
+    auto onBox = [&] (uint32_t type, const uint8_t* moof, size_t size)
+      {
+        auto const isFragmentStart = type == fourccToInt("moof") || type == fourccToInt("styp");
+
+        if(isFragmentStart && lastFragment >= 0)
+        {
+          switchUrl = scheduler->takeSwitchUrl(tile, url);
+
+          if(!switchUrl.empty())
+            return Mp4BoxSplitter::Stop;
+        }
+
+        if(moof)
+          lastFragment = getDecodeTime(moof, size, lastFragment);
+
+        return Mp4BoxSplitter::Forward;
+      };
+
+    try
+    {
+      transfer->wget(url, [&] (SpanC data)
+        {
+          if(!bytes)
+            traceInstant("net", "first byte", tile, url);
+
+          bytes += data.len;
+
+          if(tile == ManifestTile)
+            manifest.append((const char*)data.ptr, data.len);
+
+          if(!fastSwitch)
+          {
+            forward(data.ptr, data.len);
+            return;
+          }
+
+          if(!splitter.push(data.ptr, data.len, onBox, forward))
+            transfer->askToExit(); // the rest comes from the new representation
+        });
+
+      if(!switchUrl.empty() && !exitRequested)
+        bytes += transferSwitched(origin, switchUrl, lastFragment, forward);
+
+      // The HTTP puller reports the connection errors and the HTTP errors (4xx/5xx)
+      // without throwing, and delivers no data then: an empty response is a failure.
+      ok = !exitRequested && bytes > 0;
+    }
+    catch(...)
+    {
+      finish();
+      throw;
+    }
+
+    finish();
+
+    // a failed refresh keeps the previous templates
+    if(tile == ManifestTile && ok)
+      scheduler->setManifest(firstTile, manifest);
+  }
+
+  // Transfers the rest of the segment from the new representation: its fragments
+  // up to 'lastFragment' were already delivered. Returns the bytes received.
+  size_t transferSwitched(string const& origin, string const& switchUrl, int64_t lastFragment, Mp4BoxSplitter::OnBytes const& forward)
+  {
+    auto const start = chrono::steady_clock::now();
+    auto puller = scheduler->takeConnection(origin);
+    setCurrent(puller.get());
+
+    // 'askToExit' might have missed it
+    if(exitRequested)
+    {
+      setCurrent(nullptr);
+      return 0;
+    }
+
+    Mp4BoxSplitter splitter;
+    size_t bytes = 0;
+    bool switched = false;
+
+    // skips the fragments up to the cut, then up to a SAP
+    auto onBox = [&] (uint32_t, const uint8_t* moof, size_t size)
+      {
+        if(!switched && moof)
+        {
+          try
+          {
+            auto const fragment = parseFragmentStart(moof, size);
+            switched = fragment.decodeTime > lastFragment && fragment.sap;
+          }
+          catch(exception const&)
+          {
+          }
+
+          if(switched)
+          {
+            scheduler->addSwitched(tile);
+            traceSpan("net", "fast switch", start, chrono::steady_clock::now(), tile, switchUrl.c_str());
+          }
+        }
+
+        return switched ? Mp4BoxSplitter::Forward : Mp4BoxSplitter::Skip;
+      };
+
+    puller->wget(switchUrl.c_str(), [&] (SpanC data)
+      {
+        bytes += data.len;
+        splitter.push(data.ptr, data.len, onBox, forward);
+      });
+
+    setCurrent(nullptr);
+
+    if(!exitRequested && bytes > 0)
+      scheduler->giveConnection(origin, move(puller));
+
+    return bytes;
+  }
+
+  // The decode time of the fragment starting with 'moof', or 'previous' if it's unreadable.
+  static int64_t getDecodeTime(const uint8_t* moof, size_t size, int64_t previous)
+  {
+    try
+    {
+      auto const decodeTime = parseFragmentStart(moof, size).decodeTime;
+      return decodeTime >= 0 ? decodeTime : previous;
+    }
+    catch(exception const&)
+    {
+      return previous;
+    }
+  }
+
+  void setCurrent(IFilePuller* puller)
+  {
+    unique_lock<mutex> lock(m);
+    current = puller;
+  }
+
+  void askToExit() override
+  {
+    exitRequested = true;
+    scheduler->wakeUp();
+
+    unique_lock<mutex> lock(m);
+
+    if(current)
+      current->askToExit();
+  }
+
+  DownloadScheduler* const scheduler;
+  int const tile;
+  int const firstTile; // of the source
+  unique_ptr<IFilePuller> manifestPuller;
+
+  atomic<bool> exitRequested { false };
+
+  mutex m; // protects below members
+  IFilePuller* current = nullptr;
+};
+
+struct ScheduledPullerFactory : IFilePullerFactory
+{
+  ScheduledPullerFactory(DownloadScheduler* scheduler_, int firstTile_) : scheduler(scheduler_), firstTile(firstTile_) {}
+
+  unique_ptr<IFilePuller> create() override
+  {
+    // the first puller is the one of the manifest
+    auto const index = created++;
+    auto const tile = index == 0 ? ManifestTile : firstTile + index - 1;
+    return make_unique<ScheduledPuller>(scheduler, tile, firstTile);
+  }
+
+  DownloadScheduler* const scheduler;
+  int const firstTile;
+  atomic<int> created { 0 };
+};
+}
+
+DownloadScheduler::DownloadScheduler(PullerCreator createPuller, PullerCreator createManifestPuller)
+  : m_createPuller(createPuller), m_createManifestPuller(createManifestPuller)
+{
+}
+
+void DownloadScheduler::setMaxInFlight(int maxInFlight)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_maxInFlight = maxInFlight;
+  m_changed.notify_all();
+}
+
+void DownloadScheduler::setPriority(int tile, int priority)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_priorities[tile] = priority;
+  m_changed.notify_all();
+}
+
+void DownloadScheduler::clearPriorities()
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_priorities.clear();
+  m_changed.notify_all();
+}
+
+unique_ptr<IFilePullerFactory> DownloadScheduler::createFactory(int firstTile)
+{
+  return make_unique<ScheduledPullerFactory>(this, firstTile);
+}
+
+void DownloadScheduler::setCapture(shared_ptr<CaptureWriter> capture)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_capture = capture;
+}
+
+void DownloadScheduler::setReplay(shared_ptr<CaptureReplay> replay)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_replay = replay;
+}
+
+shared_ptr<CaptureWriter> DownloadScheduler::getCapture()
+{
+  unique_lock<mutex> lock(m_mutex);
+  return m_capture;
+}
+
+shared_ptr<CaptureReplay> DownloadScheduler::getReplay()
+{
+  unique_lock<mutex> lock(m_mutex);
+  return m_replay;
+}
+
+void DownloadScheduler::setPaused(bool paused)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_paused = paused;
+  m_changed.notify_all();
+}
+
+void DownloadScheduler::setFastSwitch(bool enabled)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_fastSwitch = enabled;
+
+  if(!enabled)
+    m_switches.clear();
+}
+
+bool DownloadScheduler::isFastSwitchEnabled()
+{
+  unique_lock<mutex> lock(m_mutex);
+  return m_fastSwitch;
+}
+
+void DownloadScheduler::requestSwitch(int tile, int quality)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_switched.erase(tile);
+
+  if(m_fastSwitch)
+    m_switches[tile] = quality;
+}
+
+void DownloadScheduler::cancelSwitch(int tile)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_switches.erase(tile);
+  m_switched.erase(tile);
+}
+
+bool DownloadScheduler::takeSwitched(int tile)
+{
+  unique_lock<mutex> lock(m_mutex);
+  return m_switched.erase(tile) > 0;
+}
+
+void DownloadScheduler::addSwitched(int tile)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_switched.insert(tile);
+}
+
+void DownloadScheduler::setManifest(int firstTile, string const& mpd)
+{
+  auto const templates = probeMpdTemplates(mpd.c_str(), mpd.size());
+
+  unique_lock<mutex> lock(m_mutex);
+
+  for(int i = 0; i < (int)templates.size(); ++i)
+    m_templates[firstTile + i] = templates[i];
+}
+
+string DownloadScheduler::takeSwitchUrl(int tile, string const& url)
+{
+  unique_lock<mutex> lock(m_mutex);
+  auto const i = m_switches.find(tile);
+
+  if(i == m_switches.end())
+    return "";
+
+  auto const quality = i->second;
+  m_switches.erase(i);
+
+  // otherwise, the switch happens at the next segment
+  auto const t = m_templates.find(tile);
+
+  if(t == m_templates.end() || !isSharedInitialization(t->second.initialization))
+    return "";
+
+  auto const& ids = t->second.representationIds;
+
+  if(quality < 0 || quality >= (int)ids.size())
+    return "";
+
+  // nothing to do if 'url' is already of the new representation
+  for(auto& id : ids)
+  {
+    if(id == ids[quality])
+      continue;
+
+    auto const r = switchRepresentation(url, t->second.media, id, ids[quality]);
+
+    if(!r.empty())
+      return r;
+  }
+
+  return "";
+}
+
+void DownloadScheduler::abortAll()
+{
+  unique_lock<mutex> pullersLock(m_pullersMutex);
+
+  {
+    unique_lock<mutex> lock(m_mutex);
+    m_aborted = true;
+    m_changed.notify_all();
+  }
+
+  for(auto puller : m_pullers)
+    puller->askToExit();
+}
+
+bool DownloadScheduler::registerPuller(IFilePuller* puller)
+{
+  unique_lock<mutex> pullersLock(m_pullersMutex);
+  m_pullers.insert(puller);
+
+  unique_lock<mutex> lock(m_mutex);
+  return !m_aborted;
+}
+
+void DownloadScheduler::unregisterPuller(IFilePuller* puller)
+{
+  unique_lock<mutex> pullersLock(m_pullersMutex);
+  m_pullers.erase(puller);
+}
+
+vector<DownloadRecord> DownloadScheduler::takeRecords(size_t maxCount)
+{
+  unique_lock<mutex> lock(m_mutex);
+  vector<DownloadRecord> r;
+
+  while(!m_records.empty() && r.size() < maxCount)
+  {
+    r.push_back(move(m_records.front()));
+    m_records.pop_front();
+  }
+
+  return r;
+}
+
+int DownloadScheduler::getPriority(int tile) const
+{
+  if(tile == ManifestTile)
+    return INT_MAX;
+
+  auto i = m_priorities.find(tile);
+  return i == m_priorities.end() ? 0 : i->second;
+}
+
+bool DownloadScheduler::isFirst(Waiter const* w) const
+{
+  for(auto other : m_waiters)
+  {
+    if(other->priority > w->priority)
+      return false;
+
+    if(other->priority == w->priority && other->arrival < w->arrival)
+      return false;
+  }
+
+  return true;
+}
+
+bool DownloadScheduler::acquire(int tile, atomic<bool> const& aborted)
+{
+  unique_lock<mutex> lock(m_mutex);
+
+  Waiter w { getPriority(tile), m_arrivals++ };
+  m_waiters.push_back(&w);
+
+  // the priority might change while waiting
+  m_changed.wait(lock, [&] ()
+    {
+      w.priority = getPriority(tile);
+      return aborted || m_aborted || (!m_paused && (!m_maxInFlight || m_inFlight < m_maxInFlight) && isFirst(&w));
+    });
+
+  m_waiters.erase(find(m_waiters.begin(), m_waiters.end(), &w));
+  m_changed.notify_all();
+
+  if(aborted || m_aborted)
+    return false;
+
+  ++m_inFlight;
+  return true;
+}
+
+void DownloadScheduler::release()
+{
+  unique_lock<mutex> lock(m_mutex);
+  --m_inFlight;
+  m_changed.notify_all();
+}
+
+void DownloadScheduler::wakeUp()
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_changed.notify_all();
+}
+
+unique_ptr<IFilePuller> DownloadScheduler::takeConnection(string const& origin)
+{
+  {
+    unique_lock<mutex> lock(m_mutex);
+    auto& idle = m_idleConnections[origin];
+
+    if(!idle.empty())
+    {
+      auto r = move(idle.back());
+      idle.pop_back();
+      return r;
+    }
+  }
+
+  return m_createPuller();
+}
+
+unique_ptr<IFilePuller> DownloadScheduler::createManifestPuller()
+{
+  return m_createManifestPuller();
+}
+
+void DownloadScheduler::giveConnection(string const& origin, unique_ptr<IFilePuller> puller)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_idleConnections[origin].push_back(move(puller));
+}
+
+void DownloadScheduler::addRecord(DownloadRecord record)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_records.push_back(move(record));
+
+  while(m_records.size() > MaxRecords)
+    m_records.pop_front();
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "lib_media/common/file_puller.hpp"
+#include "capture.h"
+#include "probe.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+// Timings of a completed HTTP request.
+struct DownloadRecord
+{
+  int tile; // -1 for the manifest
+  std::string url;
+  std::chrono::steady_clock::duration queueing; // waiting for a slot
+  std::chrono::steady_clock::duration transfer;
+  size_t bytes;
+  bool ok; // received data, and wasn't interrupted
+};
+
+// Orders the HTTP requests of all the DASH sources of a session:
+// - at most 'maxInFlight' requests transfer at once (0: no limit),
+// - waiting requests are granted by decreasing tile priority, then by arrival,
+//   the manifest requests coming first,
+// - the connections are kept alive and reused per origin,
+// - each manifest has its own puller ('createManifestPuller'), e.g for conditional refreshes.
+// The DASH input downloads synchronously: a request holds its caller's thread
+// until it is granted and transferred.
+struct DownloadScheduler
+{
+  using PullerCreator = std::function<std::unique_ptr<Modules::In::IFilePuller>()>;
+
+  DownloadScheduler(PullerCreator createPuller, PullerCreator createManifestPuller);
+
+  void setMaxInFlight(int maxInFlight);
+  void setPriority(int tile, int priority);
+  void clearPriorities();
+
+  // Creates the puller factory to give to a DashDemuxer.
+  // The DASH input creates a puller for the manifest, then one per adaptation set:
+  // the pullers are mapped to the tiles in creation order, from 'firstTile'.
+  std::unique_ptr<Modules::In::IFilePullerFactory> createFactory(int firstTile);
+
+  // Records the downloads into 'capture'. Null to stop.
+  void setCapture(std::shared_ptr<CaptureWriter> capture);
+
+  // Serves the downloads from 'replay' instead of the network. Null to stop.
+  // The replayed downloads aren't scheduled: the capture holds the original timing.
+  void setReplay(std::shared_ptr<CaptureReplay> replay);
+
+  // Holds the new requests until unpaused. The transfers in progress complete.
+  void setPaused(bool paused);
+
+  // Switches the representation of a tile at the next fragment of the segment being downloaded,
+  // rather than at the next segment (see fast_switch.h). Not applied to the replayed downloads.
+  void setFastSwitch(bool enabled);
+
+  // The DASH input is asked for 'quality' too: a switch which can't be done mid-segment
+  // happens at the next segment.
+  void requestSwitch(int tile, int quality);
+  void cancelSwitch(int tile);
+
+  // Returns true once per switch of this tile done mid-segment.
+  bool takeSwitched(int tile);
+
+  // Cancels the transfers in progress and the waiting requests, for good:
+  // the later requests fail immediately.
+  void abortAll();
+
+  // Dequeues the timings of the completed requests, oldest first.
+  std::vector<DownloadRecord> takeRecords(size_t maxCount);
+
+  // internal, used by the pullers
+  bool acquire(int tile, std::atomic<bool> const& aborted);
+  void release();
+  void wakeUp();
+  std::unique_ptr<Modules::In::IFilePuller> takeConnection(std::string const& origin);
+  std::unique_ptr<Modules::In::IFilePuller> createManifestPuller();
+  void giveConnection(std::string const& origin, std::unique_ptr<Modules::In::IFilePuller> puller);
+  void addRecord(DownloadRecord record);
+  bool registerPuller(Modules::In::IFilePuller* puller); // returns false if aborted
+  void unregisterPuller(Modules::In::IFilePuller* puller);
+  std::shared_ptr<CaptureWriter> getCapture();
+  std::shared_ptr<CaptureReplay> getReplay();
+  bool isFastSwitchEnabled();
+  void setManifest(int firstTile, std::string const& mpd);
+  std::string takeSwitchUrl(int tile, std::string const& url); // empty if no switch to do
+  void addSwitched(int tile);
+
+  private:
+    struct Waiter
+    {
+      int priority;
+      uint64_t arrival;
+    };
+
+    bool isFirst(Waiter const* w) const;
+    int getPriority(int tile) const;
+
+    PullerCreator const m_createPuller;
+    PullerCreator const m_createManifestPuller;
+
+    std::mutex m_mutex; // protects below members
+    std::condition_variable m_changed;
+    bool m_aborted = false;
+    bool m_paused = false;
+    int m_maxInFlight = 0;
+    int m_inFlight = 0;
+    uint64_t m_arrivals = 0;
+    std::vector<Waiter const*> m_waiters;
+    std::map<int, int> m_priorities;
+    std::map<std::string, std::vector<std::unique_ptr<Modules::In::IFilePuller>>> m_idleConnections;
+    std::deque<DownloadRecord> m_records;
+    std::shared_ptr<CaptureWriter> m_capture;
+    std::shared_ptr<CaptureReplay> m_replay;
+    bool m_fastSwitch = false;
+    std::map<int, ProbedTemplate> m_templates; // per tile, from the last manifest
+    std::map<int, int> m_switches; // per tile, the requested quality
+    std::set<int> m_switched;
+
+    std::mutex m_pullersMutex; // protects below members, taken before 'm_mutex'
+    std::set<Modules::In::IFilePuller*> m_pullers;
+};
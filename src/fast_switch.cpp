@@ -0,0 +1,151 @@
+#include "fast_switch.h"
+#include "mp4_index.h"
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+namespace
+{
+auto const RepresentationKey = string("$RepresentationID$");
+
+// Bigger 'moof' boxes aren't gathered, and can't start a switch.
+auto const MaxMoofSize = 1024 * 1024;
+
+uint64_t readBE(const uint8_t* p, int nbytes)
+{
+  uint64_t r = 0;
+
+  for(int i = 0; i < nbytes; ++i)
+    r = (r << 8) | p[i];
+
+  return r;
+}
+}
+
+string switchRepresentation(string const& url, string const& media, string const& fromId, string const& toId)
+{
+  auto const at = media.find(RepresentationKey);
+
+  if(at == string::npos || fromId.empty())
+    return "";
+
+  // the literal text around the identifier, up to the neighbouring identifiers.
+  // At the start of the template, the identifier follows the '/' of the base URL.
+  auto const prevKey = at ? media.rfind('$', at - 1) : string::npos;
+  auto const beforeStart = prevKey == string::npos ? 0 : prevKey + 1;
+  auto const before = at ? media.substr(beforeStart, at - beforeStart) : string("/");
+
+  auto const afterStart = at + RepresentationKey.size();
+  auto const nextKey = media.find('$', afterStart);
+  auto const after = media.substr(afterStart, nextKey == string::npos ? string::npos : nextKey - afterStart);
+
+  // e.g "$Number$$RepresentationID$": can't be told apart
+  if(before.empty() && after.empty())
+    return "";
+
+  auto const from = before + fromId + after;
+  auto const pos = url.rfind(from);
+
+  if(pos == string::npos)
+    return "";
+
+  return url.substr(0, pos) + before + toId + after + url.substr(pos + from.size());
+}
+
+bool isSharedInitialization(string const& initialization)
+{
+  return initialization.find(RepresentationKey) == string::npos && initialization.find("$Bandwidth$") == string::npos;
+}
+
+size_t Mp4BoxSplitter::wanted() const
+{
+  if(m_pending.size() < 8)
+    return 8;
+
+  uint64_t size = readBE(m_pending.data(), 4);
+  auto const type = (uint32_t)readBE(m_pending.data() + 4, 4);
+  size_t headerSize = 8;
+
+  if(size == 1)
+  {
+    if(m_pending.size() < 16)
+      return 16;
+
+    size = readBE(m_pending.data() + 8, 8);
+    headerSize = 16;
+  }
+
+  if(type == fourccToInt("moof") && size >= headerSize && size <= MaxMoofSize)
+    return (size_t)size;
+
+  return headerSize;
+}
+
+bool Mp4BoxSplitter::push(const uint8_t* data, size_t len, OnBox const& onBox, OnBytes const& forward)
+{
+  while(len && !m_stopped)
+  {
+    if(m_passThrough)
+    {
+      forward(data, len);
+      break;
+    }
+
+    if(m_remaining)
+    {
+      auto const n = (size_t)min<uint64_t>(m_remaining, len);
+
+      if(m_forwarding)
+        forward(data, n);
+
+      data += n;
+      len -= n;
+      m_remaining -= n;
+      continue;
+    }
+
+    // the header of the next box, then the whole box if it's a 'moof'
+    auto const n = min(wanted() - m_pending.size(), len);
+    m_pending.insert(m_pending.end(), data, data + n);
+    data += n;
+    len -= n;
+
+    if(m_pending.size() < wanted())
+      continue;
+
+    auto const largeSize = readBE(m_pending.data(), 4) == 1;
+    auto const headerSize = largeSize ? 16 : 8;
+    auto const type = (uint32_t)readBE(m_pending.data() + 4, 4);
+    auto size = largeSize ? readBE(m_pending.data() + 8, 8) : readBE(m_pending.data(), 4);
+
+    if(size == 0)
+      size = UINT64_MAX; // up to the end of the stream
+    else if(size < (uint64_t)headerSize)
+    {
+      m_passThrough = true;
+      forward(m_pending.data(), m_pending.size());
+      m_pending.clear();
+      continue;
+    }
+
+    auto const whole = type == fourccToInt("moof") && m_pending.size() == size;
+    auto const action = onBox(type, whole ? m_pending.data() : nullptr, whole ? m_pending.size() : 0);
+
+    if(action == Stop)
+    {
+      m_stopped = true;
+      break;
+    }
+
+    m_forwarding = action == Forward;
+
+    if(m_forwarding)
+      forward(m_pending.data(), m_pending.size());
+
+    m_remaining = size - m_pending.size();
+    m_pending.clear();
+  }
+
+  return !m_stopped;
+}
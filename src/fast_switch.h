@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Quality switches in the middle of a segment (see lldplay_set_fast_switch).
+// The transfer of the current segment is cut before its next fragment ('moof'),
+// and the segment goes on from the same segment of the new representation,
+// from its first fragment after the cut that starts with a SAP.
+// The DASH input sees one segment, made of the fragments of both representations:
+// this requires the representations to share their initialization segment.
+
+// The URL of the segment 'url' of representation 'fromId', in representation 'toId',
+// from the segment template 'media'. Returns an empty string if 'url' doesn't match the template.
+std::string switchRepresentation(std::string const& url, std::string const& media, std::string const& fromId, std::string const& toId);
+
+// Whether all the representations use the initialization segment of 'initialization' (a template).
+bool isSharedInitialization(std::string const& initialization);
+
+// Splits a fragmented MP4 byte stream into its top-level boxes, as the bytes arrive.
+// A byte stream which isn't made of boxes is passed through.
+struct Mp4BoxSplitter
+{
+  enum Action
+  {
+    Forward,
+    Skip,
+    Stop,
+  };
+
+  // Called at the start of each top-level box, with the whole box if it's a 'moof' (null otherwise).
+  using OnBox = std::function<Action(uint32_t type, const uint8_t* moof, size_t size)>;
+  using OnBytes = std::function<void(const uint8_t* data, size_t len)>;
+
+  // Passes the bytes of the forwarded boxes to 'forward'.
+  // Returns false once stopped: the stopping box, and the bytes after it, aren't forwarded.
+  bool push(const uint8_t* data, size_t len, OnBox const& onBox, OnBytes const& forward);
+
+  private:
+    size_t wanted() const;
+
+    std::vector<uint8_t> m_pending; // the header of the next box, or the whole 'moof'
+    uint64_t m_remaining = 0; // in the current box
+    bool m_forwarding = true; // the current box
+    bool m_stopped = false;
+    bool m_passThrough = false;
+};
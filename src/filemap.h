@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Read-only view of a whole file, mapped into the address space.
+// The contents are paged-in on demand by the OS.
+struct FileMapping
+{
+  virtual ~FileMapping() = default;
+  virtual const uint8_t* data() const = 0;
+  virtual size_t size() const = 0;
+
+  // Hints the OS that [offset, offset+len) is going to be read soon.
+  virtual void prefetch(size_t offset, size_t len) = 0;
+};
+
+std::unique_ptr<FileMapping> mapFile(const char* path);
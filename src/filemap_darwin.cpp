@@ -0,0 +1,74 @@
+// this file is macOS specific
+#include "filemap.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+struct FileMappingDarwin : FileMapping
+{
+  FileMappingDarwin(const char* path)
+  {
+    auto fd = open(path, O_RDONLY);
+
+    if(fd < 0)
+      throw runtime_error(string("can't open '") + path + "' (" + strerror(errno) + ")");
+
+    struct stat st {};
+
+    if(fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+      close(fd);
+      throw runtime_error(string("can't map '") + path + "': empty or unreadable file");
+    }
+
+    len = (size_t)st.st_size;
+    ptr = (uint8_t*)mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(ptr == MAP_FAILED)
+      throw runtime_error(string("can't map '") + path + "' (" + strerror(errno) + ")");
+
+    madvise(ptr, len, MADV_SEQUENTIAL);
+  }
+
+  ~FileMappingDarwin()
+  {
+    munmap(ptr, len);
+  }
+
+  const uint8_t* data() const override
+  {
+    return ptr;
+  }
+
+  size_t size() const override
+  {
+    return len;
+  }
+
+  void prefetch(size_t offset, size_t n) override
+  {
+    if(offset >= len)
+      return;
+
+    auto const pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    auto const begin = offset - offset % pageSize;
+    auto const end = min(offset + n, len);
+    madvise(ptr + begin, end - begin, MADV_WILLNEED);
+  }
+
+  uint8_t* ptr;
+  size_t len;
+};
+
+unique_ptr<FileMapping> mapFile(const char* path)
+{
+  return make_unique<FileMappingDarwin>(path);
+}
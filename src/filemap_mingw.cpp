@@ -0,0 +1,76 @@
+// this file is MS Windows specific
+#include "filemap.h"
+#include <windows.h>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+struct FileMappingMingw : FileMapping
+{
+  FileMappingMingw(const char* path)
+  {
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if(file == INVALID_HANDLE_VALUE)
+      throw runtime_error(string("can't open '") + path + "'");
+
+    LARGE_INTEGER fileSize {};
+
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+      CloseHandle(file);
+      throw runtime_error(string("can't map '") + path + "': empty or unreadable file");
+    }
+
+    len = (size_t)fileSize.QuadPart;
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if(!mapping)
+    {
+      CloseHandle(file);
+      throw runtime_error(string("can't map '") + path + "'");
+    }
+
+    ptr = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if(!ptr)
+    {
+      CloseHandle(mapping);
+      CloseHandle(file);
+      throw runtime_error(string("can't map '") + path + "'");
+    }
+  }
+
+  ~FileMappingMingw()
+  {
+    UnmapViewOfFile(ptr);
+    CloseHandle(mapping);
+    CloseHandle(file);
+  }
+
+  const uint8_t* data() const override
+  {
+    return ptr;
+  }
+
+  size_t size() const override
+  {
+    return len;
+  }
+
+  void prefetch(size_t, size_t) override
+  {
+    // FILE_FLAG_SEQUENTIAL_SCAN already enables aggressive read-ahead.
+  }
+
+  HANDLE file;
+  HANDLE mapping;
+  const uint8_t* ptr;
+  size_t len;
+};
+
+unique_ptr<FileMapping> mapFile(const char* path)
+{
+  return make_unique<FileMappingMingw>(path);
+}
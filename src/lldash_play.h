@@ -13,7 +13,8 @@
 #define LLDPLAY_EXPORT __attribute__((visibility("default")))
 #endif
 
-const uint64_t LLDASH_PLAYOUT_API_VERSION = 0x20250722;
+const uint64_t LLDASH_PLAYOUT_API_VERSION = 0x20261018;
+const uint32_t LLDASH_PLAYOUT_OPTIONS_VERSION = 2;
 
 struct FrameInfo
 {
@@ -29,6 +30,86 @@ extern "C" {
 // opaque handle to a signals pipeline
 struct lldplay_handle;
 
+enum LLDashPlayoutThreading
+{
+  LLDPLAY_THREADING_ONE_PER_MODULE = 0, // default: lowest latency
+  LLDPLAY_THREADING_SINGLE = 1, // all the modules share one thread: lowest CPU usage
+};
+
+// Creation options. Zero-initialize, then set 'version'.
+struct LLDashPlayoutOptions
+{
+  // must be LLDASH_PLAYOUT_OPTIONS_VERSION
+  uint32_t version;
+
+  // one of LLDashPlayoutThreading
+  int threading;
+
+  // CPU affinity of the pipeline threads (network, demux and delivery):
+  // bit N allows CPU N. Zero for no restriction.
+  // Not supported on macOS.
+  uint64_t cpuAffinityMask;
+
+  // Priority of the pipeline threads: from -20 (highest) to 19 (lowest), like 'nice'.
+  // Zero keeps the default priority. Raising it might require privileges.
+  int threadPriority;
+
+  // Frames preallocated per stream, in the demuxer buffer pool (local files)
+  // and in the delivery queue. Also the most frames a local file demuxer keeps in flight.
+  // Zero for the default (64).
+  int framesPerStream;
+};
+
+// Timings of a completed HTTP request.
+struct DownloadTiming
+{
+  int tileNumber; // -1 for the manifest
+  int ok; // zero if the transfer failed (no data received, e.g HTTP errors) or was interrupted
+
+  int64_t queueingTimeUs; // waiting behind the other requests
+  int64_t transferTimeUs;
+  uint64_t bytes;
+
+  char url[256]; // truncated if longer
+};
+
+// Delivery counters of a stream, since its creation.
+struct StreamStats
+{
+  uint64_t framesReceived;
+
+  uint32_t queuedFrames; // waiting to be grabbed
+  uint32_t queueCapacity;
+
+  // Allocations on the delivery path, once the preallocated buffers ran out:
+  // the pool misses, the frames too large for a pool buffer, and the queue growths.
+  // Stays at zero in steady state when 'framesPerStream' is large enough.
+  uint64_t allocations;
+
+  // Frames which found all the preallocated buffers in use (a subset of 'allocations').
+  uint64_t poolExhaustions;
+
+  // Recovery of the stream source (network sources only, see lldplay_set_reconnect_policy).
+  uint32_t reconnections;
+  uint64_t outageDurationMs; // total, including the ongoing outage
+  int outage; // non-zero while no frame is received
+
+  // From the addition of the source to its first frame. Zero until then.
+  uint64_t timeToFirstFrameMs;
+
+  // Quality switches of the tile ('lldplay_enable_stream'), from the call
+  // to the first frame of the new quality. A switch superseded before completion isn't counted.
+  uint32_t switches; // completed
+  uint64_t lastSwitchLatencyMs;
+  uint64_t maxSwitchLatencyMs;
+
+  // From the last 'lldplay_resume' to the first frame. Zero until then.
+  uint64_t lastResumeLatencyMs;
+
+  // Quality switches completed mid-segment (see lldplay_set_fast_switch), a subset of 'switches'.
+  uint32_t fastSwitches;
+};
+
 struct StreamDesc
 {
   uint32_t MP4_4CC;
@@ -42,34 +123,217 @@ struct StreamDesc
   uint32_t totalHeight;
 };
 
+// One stream, as read by a consumer (see lldplay_add_consumer).
+struct ConsumerStats
+{
+  uint64_t framesRead;
+  uint64_t framesDropped; // skipped because the consumer lagged more than its 'maxLag'
+  uint32_t lag; // frames waiting to be read
+};
+
+// Mapping of the presentation times to the local monotonic time (see lldplay_set_jitter_buffer).
+// The frame presented at 'mediaTimeMs' is released at 'localTimeUs', any other
+// presentation time t at localTimeUs + (t - mediaTimeMs) * 1000.
+struct PlayoutClock
+{
+  int64_t mediaTimeMs;
+  int64_t localTimeUs;
+  int64_t nowUs; // current local time, on the same clock as 'localTimeUs'
+
+  int delayMs; // above the smallest transit time, follows the jitter
+  float jitterMs; // estimated arrival jitter
+  uint64_t lateFrames; // arrived after their playout time, released at once
+};
+
+// One tile of a frame set.
+struct FrameSetEntry
+{
+  int tileNumber;
+
+  // non-zero if the tile has no frame for this presentation time
+  // (late or lost when the deadline expired).
+  int missing;
+
+  // position and size of the frame in the destination buffer
+  size_t offset;
+  size_t size;
+
+  FrameInfo info;
+};
+
+enum LLDashPlayoutLibavProfile
+{
+  LLDPLAY_LIBAV_DEFAULT = 0, // libav defaults: reliable stream detection, seconds of startup
+  LLDPLAY_LIBAV_LOW_LATENCY = 1, // minimal probing, no input buffering
+};
+
+enum LLDashPlayoutFrameFormat
+{
+  LLDPLAY_FRAME_FORMAT_AS_IS = 0, // as stored in the container
+  LLDPLAY_FRAME_FORMAT_ANNEXB = 1, // NAL units with start codes
+  LLDPLAY_FRAME_FORMAT_ANNEXB_WITH_PARAMS = 2, // same, with the parameter sets of the DSI before each keyframe
+};
+
+enum LLDashPlayoutResumeMode
+{
+  LLDPLAY_RESUME_CONTINUE = 0, // from the pause point
+  LLDPLAY_RESUME_LIVE_EDGE = 1, // the network sources reconnect at the live edge
+};
+
 enum LLDashPlayoutMessageLevel { SubMessageError=0, SubMessageWarning, SubMessageInfo, SubMessageDebug };
 typedef void (*LLDashPlayoutMessageCallback)(const char *msg, int level);
 
 // Creates a new pipeline.
 // name: a display name for log messages. Can be NULL.
+// options: threading and scheduling of the pipeline. Can be NULL for the defaults.
 // The returned pipeline must be freed using 'sub_destroy'.
-LLDPLAY_EXPORT lldplay_handle* lldplay_create(const char* name, LLDashPlayoutMessageCallback onError, int maxLevel, uint64_t api_version = LLDASH_PLAYOUT_API_VERSION);
+LLDPLAY_EXPORT lldplay_handle* lldplay_create(const char* name, LLDashPlayoutMessageCallback onError, int maxLevel, uint64_t api_version = LLDASH_PLAYOUT_API_VERSION, const struct LLDashPlayoutOptions* options = nullptr);
 
 // Destroys a pipeline. This frees all the resources.
+// Returns within a bounded time (2s): a teardown not finished by then
+// is completed in the background (see lldplay_stop and lldplay_wait_teardown).
 LLDPLAY_EXPORT void lldplay_destroy(lldplay_handle* h);
 
-// Plays a given URL. Call this function maximum once per session.
+// Waits at most 'timeoutMs' for the teardowns that 'lldplay_destroy' left running in the background.
+// Returns true when none is left: only then can this library be unloaded,
+// as these teardowns run its code.
+LLDPLAY_EXPORT bool lldplay_wait_teardown(int timeoutMs);
+
+// Stops a pipeline: aborts the downloads, releases the waiting frames,
+// and stops the sources and the pipeline threads.
+// Waits at most 'timeoutMs' for the teardown, which continues in the background otherwise.
+// Returns true when the teardown is complete. Can be called again to keep waiting.
+// After this call, only 'lldplay_stop' and 'lldplay_destroy' can be called on the handle.
+LLDPLAY_EXPORT bool lldplay_stop(lldplay_handle* h, int timeoutMs);
+
+// Plays a given URL: a DASH manifest, or a local MP4 file (demuxed in place from its memory mapping).
+// Fails if already playing: use 'lldplay_add_source' to play more URLs, or 'lldplay_switch' to replace it.
 LLDPLAY_EXPORT bool lldplay_play(lldplay_handle* h, const char* URL);
 
+// Plays one more URL in the same pipeline, e.g to composite several sources.
+// Its streams are appended after the existing ones.
+// Returns: the source id, or -1 on error.
+LLDPLAY_EXPORT int lldplay_add_source(lldplay_handle* h, const char* URL);
+
+// Stops and releases a source. The other sources keep playing.
+// The stream indices of the removed source stay allocated, but won't receive any more frames.
+// Can't be called while paused.
+LLDPLAY_EXPORT bool lldplay_remove_source(lldplay_handle* h, int sourceId);
+
+// Replaces all the sources of a playing handle by a single new one (channel switching).
+// The pipeline threads, the HTTP connections and the handle settings are kept,
+// which makes it faster than destroying the handle and creating a new one.
+// The stream table is rebuilt: the stream indices start over from zero, the queued frames
+// are dropped, and the stream settings (qualities, priorities, subscriptions, formats, exports) are reset.
+// Can't be called while paused.
+LLDPLAY_EXPORT bool lldplay_switch(lldplay_handle* h, const char* URL);
+
+// Gets the range of stream indices belonging to a source. Pointers can be NULL.
+LLDPLAY_EXPORT bool lldplay_get_source_streams(lldplay_handle* h, int sourceId, int* firstStreamIndex, int* streamCount);
+
 // Returns the number of compressed streams.
 LLDPLAY_EXPORT int lldplay_get_stream_count(lldplay_handle* h);
 
 // Returns the 4CC of a given stream. Desc is owned by the caller.
 LLDPLAY_EXPORT bool lldplay_get_stream_info(lldplay_handle* h, int streamIndex, struct StreamDesc* desc);
 
+// Gets the delivery counters of a stream. Stats are owned by the caller.
+LLDPLAY_EXPORT bool lldplay_get_stream_stats(lldplay_handle* h, int streamIndex, struct StreamStats* stats);
+
 // Enables a quality or disables a tile. There is at most one stream enabled per tile.
-// These functions might not return immediately. The change will occur at the next segment boundary.
+// These functions might not return immediately. The change will occur at the next segment boundary,
+// or at the next fragment for the quality switches in fast switch mode (see lldplay_set_fast_switch).
 // By default the first stream of each tile is enabled.
 // Associations between streamIndex and tiles are given by sub_get_stream_info().
 // Beware that disabling all qualities from all tiles will stop the session.
 LLDPLAY_EXPORT bool lldplay_enable_stream(lldplay_handle* h, int tileNumber, int quality);
 LLDPLAY_EXPORT bool lldplay_disable_stream(lldplay_handle* h, int tileNumber);
 
+// Fast switch mode: a quality switch ('lldplay_enable_stream' on an enabled tile) occurs in the middle
+// of the segment being downloaded, at its next fragment, rather than at the next segment.
+// The rest of the segment is requested from the new representation, and is delivered from its
+// first fragment past the switch point that starts with a SAP.
+// Applies to the DASH sources whose representations share their segment template and their
+// initialization segment. The other switches occur at the next segment boundary.
+// Disabled by default.
+LLDPLAY_EXPORT bool lldplay_set_fast_switch(lldplay_handle* h, bool enabled);
+
+// Subscribes to a stream, or unsubscribes from it, with all the qualities of its tile.
+// All the streams are subscribed by default.
+// The frames of an unsubscribed stream are dropped as soon as demuxed (e.g unused audio or metadata tracks),
+// and the DASH tiles aren't downloaded at all. Its queued frames are dropped.
+// The enabled quality of the tile ('lldplay_enable_stream') is kept, and applies when subscribing again.
+LLDPLAY_EXPORT bool lldplay_subscribe(lldplay_handle* h, int streamIndex, bool subscribe);
+
+// Sets the download priority of a tile. The higher, the sooner.
+// When the number of simultaneous downloads is capped, the waiting segment requests
+// are served by decreasing priority, then by arrival. Defaults to 0.
+// The manifest requests always come first.
+LLDPLAY_EXPORT bool lldplay_set_stream_priority(lldplay_handle* h, int tileNumber, int priority);
+
+// Sets the format of the frames delivered for a tile, from 'LLDashPlayoutFrameFormat'.
+// The conversion happens while copying the frames into the caller buffer.
+// Only applies to H.264 and H.265 tiles from MP4 (length-prefixed NAL units), the others are delivered as-is.
+// Defaults to LLDPLAY_FRAME_FORMAT_AS_IS.
+LLDPLAY_EXPORT bool lldplay_set_frame_format(lldplay_handle* h, int tileNumber, int frameFormat);
+
+// Delivers the frames of a tile to other processes, through the shared-memory ring 'name'
+// (e.g "/lldash-tile0"), instead of 'lldplay_grab_frame'. One download feeds any number of local consumers.
+// The frames are in the format set by 'lldplay_set_frame_format'.
+// The ring keeps the last 'slotCount' frames. Frames larger than 'slotSize' bytes are dropped.
+// A NULL 'name' stops the export. The ring is removed when the export stops.
+LLDPLAY_EXPORT bool lldplay_export_stream(lldplay_handle* h, int tileNumber, const char* name, int slotCount, int slotSize);
+
+// Reading of an exported stream, from any process. No pipeline is needed.
+// Each reader starts at the live edge and never slows down the exporter:
+// the frames overwritten before being read are skipped, and counted as lost.
+struct lldplay_shm_reader;
+
+// Returns NULL if the ring doesn't exist.
+LLDPLAY_EXPORT struct lldplay_shm_reader* lldplay_shm_open(const char* name);
+
+// Waits up to 'timeoutMs' for the next frame, and copies it to 'dst'.
+// Returns: the size of the frame, or zero if none came, the export stopped, or 'dst' is too small.
+// If 'dst' is null, only returns the size of the next frame, without consuming it.
+LLDPLAY_EXPORT size_t lldplay_shm_read(struct lldplay_shm_reader* r, uint8_t* dst, size_t dstLen, FrameInfo* info, int timeoutMs);
+
+// Returns the number of frames overwritten before this reader could read them.
+LLDPLAY_EXPORT uint64_t lldplay_shm_get_lost(struct lldplay_shm_reader* r);
+
+LLDPLAY_EXPORT void lldplay_shm_close(struct lldplay_shm_reader* r);
+
+// Latency of a probe (see lldplay_probe).
+struct ProbeInfo
+{
+  int64_t latencyUs; // of the call
+  int64_t probeLatencyUs; // of the download and parsing, possibly by an earlier call
+  int cached; // non-zero if the streams come from the cache
+};
+
+typedef void (*LLDashPlayoutProbeCallback)(void* userData, const struct StreamDesc* streams, int streamCount, const struct ProbeInfo* info);
+
+// Describes the streams of a source without playing it, and without any handle:
+// only the manifest is downloaded (DASH), or the file index is read (local MP4 files).
+// The streams are described as by 'lldplay_get_stream_info', in the order of the stream indices.
+// They are passed to 'callback' before the function returns, and are only valid during the call.
+// The results are cached by URL: the ones younger than 'maxAgeMs' are reused (0: always probe).
+// Contribution feeds (see lldplay_set_libav_profile) can't be probed.
+LLDPLAY_EXPORT bool lldplay_probe(const char* url, LLDashPlayoutProbeCallback callback, void* userData, int maxAgeMs);
+
+// Sets how the contribution feeds are read (rtmp://, rtsp://, srt://, udp://, tcp://, rtp:// URLs),
+// from 'LLDashPlayoutLibavProfile'. udp://, srt:// and tcp:// feeds must be MPEG-TS in low-latency mode.
+// options: extra libav options, appended to the ones of the profile, e.g "-rtsp_transport tcp". Can be NULL.
+// Applies to the sources added afterwards. Defaults to LLDPLAY_LIBAV_DEFAULT.
+LLDPLAY_EXPORT bool lldplay_set_libav_profile(lldplay_handle* h, int profile, const char* options);
+
+// Caps the number of simultaneous HTTP downloads of the DASH sources. 0 (the default) for no cap.
+// Whatever the cap, the connections are kept alive and reused per origin server.
+LLDPLAY_EXPORT bool lldplay_set_max_downloads(lldplay_handle* h, int maxDownloads);
+
+// Dequeues the timings of the last completed HTTP requests (up to 1024 are kept), oldest first.
+// Returns: the number of timings copied.
+LLDPLAY_EXPORT int lldplay_get_download_timings(lldplay_handle* h, struct DownloadTiming* timings, int maxCount);
+
 // Copy the next received compressed frame to a buffer.
 // Returns: the size of compressed data actually copied,
 // or zero, if no frame was available for this stream.
@@ -77,6 +341,99 @@ LLDPLAY_EXPORT bool lldplay_disable_stream(lldplay_handle* h, int tileNumber);
 // Note that you shall dequeue all data from all streams to avoid being locked.
 LLDPLAY_EXPORT size_t lldplay_grab_frame(lldplay_handle* h, int streamIndex, uint8_t* dst, size_t dstLen, FrameInfo* info);
 
+// Adds a reader of all the streams, with its own read position: the frames are
+// shared (not copied) between the consumers, and released once all of them read them.
+// 'lldplay_grab_frame' and 'lldplay_grab_frameset' are the default consumer, whose id is 0.
+// A consumer more than 'maxLag' frames behind on a stream skips the oldest ones,
+// so it can't hold the frames back. The default consumer has no such limit.
+// Returns: the consumer id, starting with the next frames, or -1 on error.
+LLDPLAY_EXPORT int lldplay_add_consumer(lldplay_handle* h, int maxLag);
+
+// Removes a consumer. Removing the default consumer (0) releases the frames it would hold,
+// when the application only reads through other consumers.
+LLDPLAY_EXPORT bool lldplay_remove_consumer(lldplay_handle* h, int consumerId);
+
+// Same as 'lldplay_grab_frame', for the given consumer.
+LLDPLAY_EXPORT size_t lldplay_consumer_grab_frame(lldplay_handle* h, int consumerId, int streamIndex, uint8_t* dst, size_t dstLen, FrameInfo* info);
+
+LLDPLAY_EXPORT bool lldplay_get_consumer_stats(lldplay_handle* h, int consumerId, int streamIndex, struct ConsumerStats* stats);
+
+// Copy the next set of frames sharing the same presentation time, one per enabled tile, to a buffer.
+// The frames are stored contiguously in 'dst', the entries describe each of them.
+// A set missing some tiles is released once its first frame has waited for the deadline.
+// Returns: the number of entries filled (one per enabled tile, the exported ones excepted), or zero if no set is ready.
+// If 'dst' is null, no frame is dequeued but the entries are filled.
+// timestamp: receives the presentation time of the set, in milliseconds. Can be NULL.
+LLDPLAY_EXPORT int lldplay_grab_frameset(lldplay_handle* h, uint8_t* dst, size_t dstLen, struct FrameSetEntry* entries, int maxEntries, int64_t* timestamp);
+
+// Sets how long the available frames of a set wait for the late tiles. Defaults to 100ms.
+LLDPLAY_EXPORT bool lldplay_set_frameset_deadline(lldplay_handle* h, int deadlineMs);
+
+// Seeks to a presentation time, in milliseconds, and resumes from the nearest preceding sync sample.
+// The frames queued before the call are dropped.
+// Only local files are seekable.
+LLDPLAY_EXPORT bool lldplay_seek(lldplay_handle* h, int64_t timestampMs);
+
+// Suspends the session, e.g while the application is in the background:
+// no new segment is requested (the transfers in progress complete), the demuxers block
+// on their next frame, and the queued frames are dropped. The stream selection is kept.
+LLDPLAY_EXPORT bool lldplay_pause(lldplay_handle* h);
+
+// Resumes a paused session, from 'LLDashPlayoutResumeMode'.
+// LLDPLAY_RESUME_LIVE_EDGE reconnects the network sources (counted in the 'reconnections' stats),
+// the local files continue from the pause point.
+// The delay to the first frame is reported in 'lastResumeLatencyMs' (see lldplay_get_stream_stats).
+LLDPLAY_EXPORT bool lldplay_resume(lldplay_handle* h, int mode);
+
+// Paces the delivery of the frames against the wallclock: frames are queued
+// when their presentation time is due, at most 'lookaheadMs' in advance.
+// Holding the frames back holds back the demuxer instead of buffering the whole source.
+// Each source is paced on its own timeline, starting from its first frame.
+// speed: 1.0 for real-time, 2.0 for twice as fast, 0 for as fast as possible.
+// Applies to all the sources, including the ones added later.
+// By default, local files are paced in real-time and network sources aren't paced.
+LLDPLAY_EXPORT bool lldplay_set_pacing(lldplay_handle* h, double speed, int lookaheadMs);
+
+// Same as 'lldplay_set_pacing', for one source only (see lldplay_add_source).
+// Overridden by the next call to 'lldplay_set_pacing'.
+LLDPLAY_EXPORT bool lldplay_set_source_pacing(lldplay_handle* h, int sourceId, double speed, int lookaheadMs);
+
+// Enables the jitter buffer: the frames are held until their playout time, on a clock shared
+// by all the streams of a source (each source has its own timeline). The playout delay adapts to the measured arrival jitter, within [minDelayMs, maxDelayMs].
+// The frames then come out of 'lldplay_grab_frame' and 'lldplay_grab_frameset' on schedule.
+// A zero 'maxDelayMs' disables the jitter buffer (the default): the frames are available as soon as received.
+LLDPLAY_EXPORT bool lldplay_set_jitter_buffer(lldplay_handle* h, int minDelayMs, int maxDelayMs);
+
+// Gets the playout clock of the jitter buffer, the one of the source of the last frame received.
+// 'lateFrames' counts the frames of all the sources.
+// Returns false when the jitter buffer is disabled, or before the first frame.
+LLDPLAY_EXPORT bool lldplay_get_playout_clock(lldplay_handle* h, struct PlayoutClock* clock);
+
+// Sets how the network sources recover from an outage (e.g the origin server restarted).
+// A source delivering no frame for 'stallTimeoutMs' gets a new demuxer,
+// which resumes at the live edge. The stream indices are kept.
+// Failed attempts are retried after a delay doubling from 'minBackoffMs' up to 'maxBackoffMs'.
+// Defaults: 3000ms, 500ms, 8000ms. A zero 'stallTimeoutMs' disables the recovery.
+LLDPLAY_EXPORT bool lldplay_set_reconnect_policy(lldplay_handle* h, int stallTimeoutMs, int minBackoffMs, int maxBackoffMs);
+
+// Records the activity of the session (segment requests, demuxing, frame queuing and grabbing,
+// quality switches) to a Chrome trace-event JSON file, e.g for https://ui.perfetto.dev.
+// There is at most one trace per process. The file is written when the trace stops:
+// call with a NULL 'path', or destroy the handle.
+// Setting the LLDPLAY_TRACE environment variable to a path traces the first created handle.
+LLDPLAY_EXPORT bool lldplay_set_trace(lldplay_handle* h, const char* path);
+
+// Records the downloads of the DASH sources (manifests, init and media segments)
+// with their arrival times, into the existing directory 'dir'.
+// Only the sources added afterwards are recorded. A NULL 'dir' stops the recording.
+LLDPLAY_EXPORT bool lldplay_set_record(lldplay_handle* h, const char* dir);
+
+// Serves the downloads of the DASH sources from a capture made by 'lldplay_set_record', instead of the network.
+// speed: 1.0 for the original timing, 2.0 for twice as fast, 0 for as fast as possible.
+// Call before adding the sources, then add them in the same order as when recording.
+// A NULL 'dir' goes back to the network.
+LLDPLAY_EXPORT bool lldplay_set_replay(lldplay_handle* h, const char* dir, double speed);
+
 // Gets the current parent version. Used to ensure build consistency.
 LLDPLAY_EXPORT const char *lldplay_get_version();
 }
@@ -33,7 +33,7 @@ void safeMain(int argc, char* argv[])
   auto func_lldplay_get_stream_info = IMPORT(lldplay_get_stream_info);
   auto func_lldplay_grab_frame = IMPORT(lldplay_grab_frame);
 
-  auto pipeline = func_lldplay_create(nullptr,  [](const char* msg, int level) { fprintf(stderr, "Level %d message: %s\n", level, msg); }, 2, LLDASH_PLAYOUT_API_VERSION);
+  auto pipeline = func_lldplay_create(nullptr,  [](const char* msg, int level) { fprintf(stderr, "Level %d message: %s\n", level, msg); }, 2, LLDASH_PLAYOUT_API_VERSION, nullptr);
   auto ret = func_lldplay_play(pipeline, url);
   (void)ret;
   assert(ret);
@@ -0,0 +1,125 @@
+// Measures the lifecycle of the handles: create, play, first frame, destroy,
+// for 1 to N handles running in parallel.
+// Offline by default (local file): doesn't depend on the network.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "lldash_play.h"
+
+using namespace std;
+
+enum Phase
+{
+  Create,
+  Play,
+  FirstFrame,
+  Destroy,
+  PhaseCount,
+};
+
+static const char* const PhaseNames[PhaseCount] = { "create", "play", "first frame", "destroy" };
+
+static auto const FirstFrameTimeout = chrono::seconds(10);
+
+struct Timings
+{
+  double ms[PhaseCount] {};
+  bool failed = false;
+};
+
+static Timings runOne(const char* url)
+{
+  Timings r;
+  vector<uint8_t> buffer(1024 * 1024);
+
+  auto last = chrono::steady_clock::now();
+  auto lap = [&] (Phase phase)
+    {
+      auto const now = chrono::steady_clock::now();
+      r.ms[phase] = chrono::duration<double, milli>(now - last).count();
+      last = now;
+    };
+
+  auto handle = lldplay_create("lifecycle-bench", nullptr, 1);
+  lap(Create);
+
+  if(!handle)
+  {
+    r.failed = true;
+    return r;
+  }
+
+  r.failed = !lldplay_play(handle, url);
+  lap(Play);
+
+  while(!r.failed && !lldplay_grab_frame(handle, 0, buffer.data(), buffer.size(), nullptr))
+  {
+    if(chrono::steady_clock::now() - last > FirstFrameTimeout)
+      r.failed = true;
+
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+
+  lap(FirstFrame);
+
+  lldplay_destroy(handle);
+  lap(Destroy);
+
+  return r;
+}
+
+static void run(const char* url, int handleCount)
+{
+  vector<Timings> timings(handleCount);
+  vector<thread> threads;
+
+  for(int i = 0; i < handleCount; ++i)
+    threads.push_back(thread([&, i] () { timings[i] = runOne(url); }));
+
+  for(auto& t : threads)
+    t.join();
+
+  int failures = 0;
+
+  for(auto& t : timings)
+    failures += t.failed;
+
+  printf("%3d handles", handleCount);
+
+  for(int phase = 0; phase < PhaseCount; ++phase)
+  {
+    vector<double> values;
+
+    for(auto& t : timings)
+      values.push_back(t.ms[phase]);
+
+    sort(values.begin(), values.end());
+    printf("   %s p50=%7.1fms max=%7.1fms", PhaseNames[phase], values[(values.size() - 1) / 2], values.back());
+  }
+
+  if(failures)
+    printf("   %d FAILED", failures);
+
+  printf("\n");
+}
+
+int main(int argc, char const* argv[])
+{
+  if(argc > 3)
+  {
+    fprintf(stderr, "Usage: %s [url] [max handle count]\n", argv[0]);
+    return 1;
+  }
+
+  auto const url = argc > 1 ? argv[1] : "data/test.mp4";
+  auto const maxHandles = argc > 2 ? atoi(argv[2]) : 64;
+
+  for(int handleCount = 1; handleCount <= maxHandles; handleCount *= 2)
+    run(url, handleCount);
+
+  return 0;
+}
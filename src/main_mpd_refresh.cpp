@@ -0,0 +1,80 @@
+// Measures the cost of the manifest refreshes of a live (many-tile) stream:
+// number of manifest requests, bytes and transfer time, from the download timings.
+// To be run against the simulator with SIMULATOR_MPD_UPDATE_PERIOD set.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "lldash_play.h"
+
+using namespace std;
+
+int main(int argc, char const* argv[])
+{
+  if(argc < 2 || argc > 3)
+  {
+    fprintf(stderr, "Usage: %s <media url> [duration in seconds]\n", argv[0]);
+    return 1;
+  }
+
+  auto const url = argv[1];
+  auto const durationInSec = argc > 2 ? atoi(argv[2]) : 10;
+
+  auto handle = lldplay_create("MpdRefresh", nullptr, 1);
+
+  if(!handle || !lldplay_play(handle, url))
+  {
+    fprintf(stderr, "can't play '%s'\n", url);
+    return 1;
+  }
+
+  auto const streamCount = lldplay_get_stream_count(handle);
+  vector<uint8_t> buffer(1024 * 1024);
+  vector<DownloadTiming> timings(1024);
+
+  int manifests = 0;
+  int segments = 0;
+  uint64_t manifestBytes = 0;
+  int64_t manifestTransferUs = 0;
+
+  auto collect = [&] ()
+    {
+      auto const count = lldplay_get_download_timings(handle, timings.data(), (int)timings.size());
+
+      for(int i = 0; i < count; ++i)
+      {
+        if(timings[i].tileNumber != -1)
+        {
+          ++segments;
+          continue;
+        }
+
+        ++manifests;
+        manifestBytes += timings[i].bytes;
+        manifestTransferUs += timings[i].transferTimeUs;
+      }
+    };
+
+  auto const start = chrono::steady_clock::now();
+
+  while(chrono::steady_clock::now() - start < chrono::seconds(durationInSec))
+  {
+    for(int i = 0; i < streamCount; ++i)
+      while(lldplay_grab_frame(handle, i, buffer.data(), buffer.size(), nullptr))
+      {
+      }
+
+    collect();
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+
+  collect();
+  lldplay_destroy(handle);
+
+  printf("%d streams, %ds: %d manifest requests (%llu bytes, %.1fms of transfer in total), %d segment requests\n",
+         streamCount, durationInSec, manifests, (unsigned long long)manifestBytes, manifestTransferUs / 1000.0, segments);
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+// Plays a live stream while its origin goes down and comes back (see scripts/reconnect_test.sh).
+// Succeeds if the frames resume on the same stream indices, after a reported outage.
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "lldash_play.h"
+
+using namespace std;
+
+int main(int argc, char const* argv[])
+{
+  if(argc != 2)
+  {
+    fprintf(stderr, "Usage: %s [media url]\n", argv[0]);
+    return 1;
+  }
+
+  auto handle = lldplay_create("ReconnectPipeline", nullptr, 2);
+  lldplay_set_reconnect_policy(handle, 1500, 250, 1000);
+
+  if(!lldplay_play(handle, argv[1]))
+    return 1;
+
+  auto const streamCount = lldplay_get_stream_count(handle);
+  vector<uint8_t> buffer(1024 * 1024);
+  bool framesBeforeOutage = false;
+  bool outageSeen = false;
+  int framesAfterOutage = 0;
+
+  for(int i = 0; i < 300 && framesAfterOutage < 10; ++i)
+  {
+    for(int k = 0; k < streamCount; ++k)
+    {
+      while(lldplay_grab_frame(handle, k, buffer.data(), buffer.size(), nullptr))
+      {
+        if(outageSeen)
+          ++framesAfterOutage;
+        else
+          framesBeforeOutage = true;
+      }
+    }
+
+    StreamStats stats {};
+    lldplay_get_stream_stats(handle, 0, &stats);
+
+    if(stats.outage && !outageSeen)
+    {
+      printf("Outage detected\n");
+      outageSeen = true;
+    }
+
+    if(i % 10 == 0)
+      printf("t=%ds: %d reconnection(s), outage=%dms\n", i / 10, (int)stats.reconnections, (int)stats.outageDurationMs);
+
+    this_thread::sleep_for(chrono::milliseconds(100));
+  }
+
+  StreamStats stats {};
+  lldplay_get_stream_stats(handle, 0, &stats);
+  auto const sameStreams = lldplay_get_stream_count(handle) == streamCount;
+
+  lldplay_destroy(handle);
+
+  printf("frames before outage: %s, outage: %s, frames after outage: %d, reconnections: %d, outage duration: %dms\n",
+         framesBeforeOutage ? "yes" : "no", outageSeen ? "yes" : "no", framesAfterOutage,
+         (int)stats.reconnections, (int)stats.outageDurationMs);
+
+  if(!framesBeforeOutage || !outageSeen || framesAfterOutage < 10 || !stats.reconnections || !stats.outageDurationMs || !sameStreams)
+    return 1;
+
+  return 0;
+}
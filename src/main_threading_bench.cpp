@@ -0,0 +1,100 @@
+// Compares the threading modes of the pipeline on a live (many-tile) stream:
+// frame latency and CPU usage.
+// The latency is only meaningful with the simulator, whose media time is the UTC time.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "lldash_play.h"
+
+using namespace std;
+
+struct Mode
+{
+  const char* name;
+  LLDashPlayoutOptions options;
+};
+
+static int64_t nowInMs()
+{
+  return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void run(Mode const& mode, const char* url, int durationInSec)
+{
+  auto handle = lldplay_create(mode.name, nullptr, 1, LLDASH_PLAYOUT_API_VERSION, &mode.options);
+
+  if(!handle || !lldplay_play(handle, url))
+  {
+    fprintf(stderr, "%s: can't play '%s'\n", mode.name, url);
+    exit(1);
+  }
+
+  auto const streamCount = lldplay_get_stream_count(handle);
+  vector<uint8_t> buffer(1024 * 1024);
+  vector<int64_t> latencies;
+
+  auto const startCpu = clock();
+  auto const startTime = chrono::steady_clock::now();
+
+  while(chrono::steady_clock::now() - startTime < chrono::seconds(durationInSec))
+  {
+    for(int i = 0; i < streamCount; ++i)
+    {
+      FrameInfo info {};
+
+      while(lldplay_grab_frame(handle, i, buffer.data(), buffer.size(), &info))
+        latencies.push_back(nowInMs() - info.timestamp);
+    }
+
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+
+  auto const cpuTime = double(clock() - startCpu) / CLOCKS_PER_SEC;
+  auto const wallTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+  lldplay_destroy(handle);
+
+  if(latencies.empty())
+  {
+    printf("%-28s %6d tiles: no frame received\n", mode.name, streamCount);
+    return;
+  }
+
+  sort(latencies.begin(), latencies.end());
+  auto percentile = [&] (int p) { return latencies[(latencies.size() - 1) * p / 100]; };
+
+  printf("%-28s %6d tiles %8d frames   latency p50=%4lldms p99=%4lldms max=%4lldms   CPU %5.1f%%\n",
+         mode.name, streamCount, (int)latencies.size(),
+         (long long)percentile(50), (long long)percentile(99), (long long)latencies.back(),
+         100.0 * cpuTime / wallTime);
+}
+
+int main(int argc, char const* argv[])
+{
+  if(argc < 2 || argc > 3)
+  {
+    fprintf(stderr, "Usage: %s <media url> [duration in seconds per mode]\n", argv[0]);
+    return 1;
+  }
+
+  auto const url = argv[1];
+  auto const duration = argc > 2 ? atoi(argv[2]) : 10;
+
+  Mode const modes[] =
+  {
+    { "one-thread-per-module", { LLDASH_PLAYOUT_OPTIONS_VERSION, LLDPLAY_THREADING_ONE_PER_MODULE, 0, 0, 0 } },
+    { "single-thread", { LLDASH_PLAYOUT_OPTIONS_VERSION, LLDPLAY_THREADING_SINGLE, 0, 0, 0 } },
+    { "one-thread-per-module@cpu0", { LLDASH_PLAYOUT_OPTIONS_VERSION, LLDPLAY_THREADING_ONE_PER_MODULE, 0x1, 0, 0 } },
+    { "one-thread-per-module@nice10", { LLDASH_PLAYOUT_OPTIONS_VERSION, LLDPLAY_THREADING_ONE_PER_MODULE, 0, 10, 0 } },
+  };
+
+  for(auto& mode : modes)
+    run(mode, url, duration);
+
+  return 0;
+}
@@ -0,0 +1,286 @@
+// Stand-in for a contribution encoder (see scripts/libav_ttff_test.sh):
+// sends the H.264 track of an MP4 file as a live MPEG-TS feed, paced in real time, looping.
+// udp: to the given port. tcp: to the first client connecting to the given port.
+// GNU/Linux only.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "annexb.h"
+#include "filemap.h"
+#include "mp4_index.h"
+
+using namespace std;
+
+namespace
+{
+auto const PmtPid = 0x1000;
+auto const VideoPid = 0x100;
+auto const TsPacketSize = 188;
+auto const PacketsPerDatagram = 7;
+
+uint32_t crc32Mpeg(const uint8_t* p, size_t len)
+{
+  uint32_t crc = 0xffffffff;
+
+  for(size_t i = 0; i < len; ++i)
+  {
+    crc ^= uint32_t(p[i]) << 24;
+
+    for(int k = 0; k < 8; ++k)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+struct TsMuxer
+{
+  vector<uint8_t> out; // whole TS packets
+
+  void writeSection(int pid, vector<uint8_t> section)
+  {
+    auto const crc = crc32Mpeg(section.data(), section.size());
+
+    for(int i = 0; i < 4; ++i)
+      section.push_back(uint8_t(crc >> (24 - 8 * i)));
+
+    vector<uint8_t> payload { 0 }; // pointer field
+    payload.insert(payload.end(), section.begin(), section.end());
+    writePackets(pid, payload, true, -1);
+  }
+
+  void writeTables()
+  {
+    writeSection(0, {
+        0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00, // PAT, ts id 1
+        0x00, 0x01, uint8_t(0xe0 | (PmtPid >> 8)), uint8_t(PmtPid & 0xff), // program 1
+      });
+
+    writeSection(PmtPid, {
+        0x02, 0xb0, 0x12, 0x00, 0x01, 0xc1, 0x00, 0x00, // PMT, program 1
+        uint8_t(0xe0 | (VideoPid >> 8)), uint8_t(VideoPid & 0xff), // PCR PID
+        0xf0, 0x00,
+        0x1b, uint8_t(0xe0 | (VideoPid >> 8)), uint8_t(VideoPid & 0xff), 0xf0, 0x00, // H.264
+      });
+  }
+
+  // timestamps in 90kHz units
+  void writeFrame(vector<uint8_t> const& frame, int64_t pts, int64_t dts)
+  {
+    auto writeTimestamp = [] (vector<uint8_t>& v, int prefix, int64_t t)
+      {
+        v.push_back(uint8_t(prefix << 4 | ((t >> 29) & 0x0e) | 1));
+        v.push_back(uint8_t(t >> 22));
+        v.push_back(uint8_t(((t >> 14) & 0xfe) | 1));
+        v.push_back(uint8_t(t >> 7));
+        v.push_back(uint8_t(((t << 1) & 0xfe) | 1));
+      };
+
+    vector<uint8_t> pes { 0x00, 0x00, 0x01, 0xe0, 0x00, 0x00, 0x80, 0xc0, 10 };
+    writeTimestamp(pes, 3, pts);
+    writeTimestamp(pes, 1, dts);
+    pes.insert(pes.end(), { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0 }); // access unit delimiter
+    pes.insert(pes.end(), frame.begin(), frame.end());
+    writePackets(VideoPid, pes, false, dts);
+  }
+
+  private:
+    int continuity[0x2000] {};
+
+    // pcr: in 90kHz units, written in the first packet. -1 for none.
+    void writePackets(int pid, vector<uint8_t> const& payload, bool isSection, int64_t pcr)
+    {
+      size_t pos = 0;
+      bool first = true;
+
+      while(pos < payload.size() || first)
+      {
+        uint8_t pkt[TsPacketSize];
+        pkt[0] = 0x47;
+        pkt[1] = uint8_t((first ? 0x40 : 0) | (pid >> 8));
+        pkt[2] = uint8_t(pid & 0xff);
+
+        // adaptation field, without its length byte
+        bool hasAdaptation = false;
+        vector<uint8_t> adaptation;
+
+        if(first && pcr >= 0)
+        {
+          hasAdaptation = true;
+          adaptation = { 0x10, uint8_t(pcr >> 25), uint8_t(pcr >> 17), uint8_t(pcr >> 9), uint8_t(pcr >> 1), uint8_t(((pcr & 1) << 7) | 0x7e), 0x00 };
+        }
+
+        auto const room = TsPacketSize - 4 - (hasAdaptation ? 1 + adaptation.size() : 0);
+        auto const n = min(room, payload.size() - pos);
+
+        // stuffing: in the adaptation field for the PES, with 0xff after a section
+        if(n < room && !isSection)
+        {
+          auto stuffing = room - n;
+
+          if(!hasAdaptation)
+          {
+            hasAdaptation = true;
+            stuffing -= 1; // length byte
+
+            if(stuffing > 0)
+            {
+              adaptation.push_back(0x00); // flags
+              stuffing -= 1;
+            }
+          }
+
+          adaptation.insert(adaptation.end(), stuffing, 0xff);
+        }
+
+        pkt[3] = uint8_t((hasAdaptation ? 0x30 : 0x10) | (continuity[pid]++ & 0x0f));
+        size_t i = 4;
+
+        if(hasAdaptation)
+        {
+          pkt[i++] = uint8_t(adaptation.size());
+          memcpy(pkt + i, adaptation.data(), adaptation.size());
+          i += adaptation.size();
+        }
+
+        memcpy(pkt + i, payload.data() + pos, n);
+        i += n;
+        memset(pkt + i, 0xff, TsPacketSize - i);
+
+        out.insert(out.end(), pkt, pkt + TsPacketSize);
+        pos += n;
+        first = false;
+      }
+    }
+};
+
+int connectOutput(string const& protocol, int port)
+{
+  sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if(protocol == "udp")
+  {
+    auto fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if(fd < 0 || connect(fd, (sockaddr*)&addr, sizeof addr) != 0)
+      throw runtime_error("can't create the UDP socket");
+
+    return fd;
+  }
+
+  auto server = socket(AF_INET, SOCK_STREAM, 0);
+  int yes = 1;
+  setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+
+  if(server < 0 || bind(server, (sockaddr*)&addr, sizeof addr) != 0 || listen(server, 1) != 0)
+    throw runtime_error("can't listen on the TCP port");
+
+  fprintf(stderr, "Waiting for a client on port %d\n", port);
+  auto fd = accept(server, nullptr, nullptr);
+  close(server);
+
+  if(fd < 0)
+    throw runtime_error("can't accept the TCP client");
+
+  return fd;
+}
+
+void safeMain(int argc, char* argv[])
+{
+  if(argc != 4)
+    throw runtime_error("Usage: ts_sender.exe <file.mp4> <udp|tcp> <port>");
+
+  auto file = mapFile(argv[1]);
+  auto tracks = parseMp4Index(file->data(), file->size());
+  Mp4Track const* video = nullptr;
+
+  for(auto& t : tracks)
+    if(t.fourcc == "avc1" || t.fourcc == "avc3")
+      video = &t;
+
+  if(!video || video->samples.empty())
+    throw runtime_error("no H.264 track");
+
+  auto const nal = parseNalConfig(video->fourcc, video->dsi.data(), video->dsi.size());
+
+  if(!nal.lengthSize)
+    throw runtime_error("the H.264 track isn't length-prefixed");
+
+  auto const fd = connectOutput(argv[2], atoi(argv[3]));
+  auto const isUdp = string(argv[2]) == "udp";
+  auto const duration = video->samples.back().dts + 1;
+  auto const start = chrono::steady_clock::now();
+
+  TsMuxer mux;
+
+  for(int64_t loop = 0;; ++loop)
+  {
+    for(auto& s : video->samples)
+    {
+      auto const dts = loop * duration + s.dts;
+      auto const pts = loop * duration + s.pts;
+      auto toUs = [&] (int64_t t) { return t * 1000000 / video->timescale; };
+
+      this_thread::sleep_until(start + chrono::microseconds(toUs(dts)));
+
+      vector<uint8_t> frame;
+
+      if(s.sync)
+      {
+        mux.writeTables();
+        frame = nal.parameterSets;
+      }
+
+      auto const offset = frame.size();
+      frame.resize(offset + getAnnexBSize(file->data() + s.offset, s.size, nal.lengthSize));
+      copyToAnnexB(frame.data() + offset, file->data() + s.offset, s.size, nal.lengthSize);
+
+      // 90kHz, shifted to keep the pts positive
+      mux.writeFrame(frame, toUs(pts) * 9 / 100 + 90000, toUs(dts) * 9 / 100 + 90000);
+
+      auto const chunk = isUdp ? size_t(TsPacketSize * PacketsPerDatagram) : mux.out.size();
+
+      for(size_t pos = 0; pos < mux.out.size(); pos += chunk)
+      {
+        auto const n = min(chunk, mux.out.size() - pos);
+
+        if(send(fd, mux.out.data() + pos, n, MSG_NOSIGNAL) < 0 && !isUdp)
+        {
+          fprintf(stderr, "The client left\n");
+          close(fd);
+          return;
+        }
+      }
+
+      mux.out.clear();
+    }
+  }
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    safeMain(argc, argv);
+    return 0;
+  }
+  catch(exception const& e)
+  {
+    fprintf(stderr, "Fatal: %s\n", e.what());
+    return 1;
+  }
+}
@@ -0,0 +1,49 @@
+// Measures the time to first frame of a source (see scripts/libav_ttff_test.sh).
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "lldash_play.h"
+
+using namespace std;
+
+int main(int argc, char const* argv[])
+{
+  if(argc != 3)
+  {
+    fprintf(stderr, "Usage: %s [media url] [libav profile: 0=default, 1=low-latency]\n", argv[0]);
+    return 1;
+  }
+
+  auto const start = chrono::steady_clock::now();
+  auto handle = lldplay_create("TtffPipeline", nullptr, 1);
+  lldplay_set_libav_profile(handle, atoi(argv[2]), nullptr);
+
+  if(!lldplay_play(handle, argv[1]))
+    return 1;
+
+  auto const opened = chrono::steady_clock::now();
+  auto const streamCount = lldplay_get_stream_count(handle);
+  vector<uint8_t> buffer(4 * 1024 * 1024);
+  int received = 0;
+
+  for(int i = 0; i < 3000 && received < 25; ++i)
+  {
+    for(int k = 0; k < streamCount; ++k)
+      while(lldplay_grab_frame(handle, k, buffer.data(), buffer.size(), nullptr))
+        ++received;
+
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+
+  StreamStats stats {};
+  lldplay_get_stream_stats(handle, 0, &stats);
+  lldplay_destroy(handle);
+
+  auto const openMs = chrono::duration_cast<chrono::milliseconds>(opened - start).count();
+  printf("%s profile=%s: open=%dms ttff=%dms frames=%d\n", argv[1], argv[2], (int)openMs, (int)stats.timeToFirstFrameMs, received);
+
+  return received ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+// Compares the channel switching paths: destroy, create and play a new handle,
+// versus 'lldplay_switch' on the same handle. Measures the time to the first frame.
+// Offline by default (local file): doesn't depend on the network.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "lldash_play.h"
+
+using namespace std;
+
+static auto const FirstFrameTimeout = chrono::seconds(10);
+
+static double msSince(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static bool waitFirstFrame(lldplay_handle* handle)
+{
+  vector<uint8_t> buffer(1024 * 1024);
+  auto const start = chrono::steady_clock::now();
+
+  while(!lldplay_grab_frame(handle, 0, buffer.data(), buffer.size(), nullptr))
+  {
+    if(chrono::steady_clock::now() - start > FirstFrameTimeout)
+      return false;
+
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+
+  return true;
+}
+
+static void print(const char* name, vector<double> values)
+{
+  sort(values.begin(), values.end());
+  printf("%-24s %4d zaps   p50=%7.1fms max=%7.1fms\n", name, (int)values.size(), values[(values.size() - 1) / 2], values.back());
+}
+
+int main(int argc, char const* argv[])
+{
+  if(argc > 4)
+  {
+    fprintf(stderr, "Usage: %s [url A] [url B] [zap count]\n", argv[0]);
+    return 1;
+  }
+
+  const char* const urls[] = { argc > 1 ? argv[1] : "data/test.mp4", argc > 2 ? argv[2] : "data/test.mp4" };
+  auto const zaps = argc > 3 ? atoi(argv[3]) : 20;
+
+  vector<double> recreate, switching;
+
+  // destroy + create + play
+  auto handle = lldplay_create("zap-bench", nullptr, 1);
+
+  if(!lldplay_play(handle, urls[0]) || !waitFirstFrame(handle))
+  {
+    fprintf(stderr, "can't play '%s'\n", urls[0]);
+    return 1;
+  }
+
+  for(int i = 1; i <= zaps; ++i)
+  {
+    auto const start = chrono::steady_clock::now();
+    lldplay_destroy(handle);
+    handle = lldplay_create("zap-bench", nullptr, 1);
+
+    if(!lldplay_play(handle, urls[i % 2]) || !waitFirstFrame(handle))
+    {
+      fprintf(stderr, "can't play '%s'\n", urls[i % 2]);
+      return 1;
+    }
+
+    recreate.push_back(msSince(start));
+  }
+
+  // lldplay_switch
+  for(int i = 0; i < zaps; ++i)
+  {
+    auto const start = chrono::steady_clock::now();
+
+    if(!lldplay_switch(handle, urls[i % 2]) || !waitFirstFrame(handle))
+    {
+      fprintf(stderr, "can't switch to '%s'\n", urls[i % 2]);
+      return 1;
+    }
+
+    switching.push_back(msSince(start));
+  }
+
+  lldplay_destroy(handle);
+
+  print("destroy+create+play", recreate);
+  print("lldplay_switch", switching);
+
+  return 0;
+}
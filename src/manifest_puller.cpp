@@ -0,0 +1,170 @@
+#include "manifest_puller.h"
+#include <curl/curl.h>
+#include <atomic>
+#include <cctype>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Modules;
+using namespace Modules::In;
+using namespace std;
+
+namespace
+{
+// e.g "ETag: \"abc\"\r\n" -> "\"abc\"", for the header named 'name' (lowercase)
+bool getHeader(string const& line, const char* name, string& value)
+{
+  auto const colon = line.find(':');
+
+  if(colon == string::npos)
+    return false;
+
+  string lowered;
+
+  for(size_t i = 0; i < colon; ++i)
+    lowered += (char)tolower((unsigned char)line[i]);
+
+  if(lowered != name)
+    return false;
+
+  auto begin = colon + 1;
+  auto end = line.size();
+
+  while(begin < end && isspace((unsigned char)line[begin]))
+    ++begin;
+
+  while(end > begin && isspace((unsigned char)line[end - 1]))
+    --end;
+
+  value = line.substr(begin, end - begin);
+  return true;
+}
+
+struct ManifestPuller : IFilePuller
+{
+  ManifestPuller() : curl(curl_easy_init())
+  {
+    if(!curl)
+      throw runtime_error("Can't create a curl handle");
+  }
+
+  ~ManifestPuller()
+  {
+    curl_easy_cleanup(curl);
+  }
+
+  void wget(const char* url, function<void(SpanC)> callback) override
+  {
+    Transfer t { this, callback, {}, {} };
+
+    // the handle keeps its connection alive from one refresh to the other
+    curl_easy_reset(curl);
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &onHeader);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &t);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &onBody);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &t);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, &onProgress);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+    curl_slist* headers = nullptr;
+
+    if(url == lastUrl && !lastEtag.empty())
+    {
+      headers = curl_slist_append(headers, ("If-None-Match: " + lastEtag).c_str());
+      curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    }
+
+    auto const res = curl_easy_perform(curl);
+    curl_slist_free_all(headers);
+
+    if(res != CURLE_OK || exitRequested)
+      return;
+
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+    if(status == 304)
+    {
+      if(url == lastUrl && !lastBody.empty())
+        callback(SpanC { lastBody.data(), lastBody.size() });
+
+      return;
+    }
+
+    if(status / 100 != 2)
+      return;
+
+    // without a validator, the next refresh can't be conditional
+    lastUrl = t.etag.empty() ? "" : url;
+    lastEtag = t.etag;
+    lastBody = t.etag.empty() ? vector<uint8_t>() : move(t.body);
+  }
+
+  void askToExit() override
+  {
+    exitRequested = true;
+  }
+
+  private:
+    struct Transfer
+    {
+      ManifestPuller* puller;
+      function<void(SpanC)> const& callback;
+      string etag;
+      vector<uint8_t> body;
+    };
+
+    static size_t onHeader(char* data, size_t size, size_t count, void* userData)
+    {
+      auto t = (Transfer*)userData;
+      auto const line = string(data, size * count);
+
+      // a new response, e.g after a redirection
+      if(line.compare(0, 5, "HTTP/") == 0)
+        t->etag.clear();
+
+      getHeader(line, "etag", t->etag);
+      return size * count;
+    }
+
+    static size_t onBody(char* data, size_t size, size_t count, void* userData)
+    {
+      auto t = (Transfer*)userData;
+      long status = 0;
+      curl_easy_getinfo(t->puller->curl, CURLINFO_RESPONSE_CODE, &status);
+
+      // the error pages aren't manifests
+      if(status / 100 == 2)
+      {
+        auto const bytes = (const uint8_t*)data;
+        t->body.insert(t->body.end(), bytes, bytes + size * count);
+        t->callback(SpanC { bytes, size * count });
+      }
+
+      return size * count;
+    }
+
+    static int onProgress(void* userData, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+    {
+      return ((ManifestPuller*)userData)->exitRequested ? 1 : 0;
+    }
+
+    CURL* const curl;
+    atomic<bool> exitRequested { false };
+
+    // the last complete manifest, and its validator
+    string lastUrl;
+    string lastEtag;
+    vector<uint8_t> lastBody;
+};
+}
+
+unique_ptr<IFilePuller> createManifestPuller()
+{
+  return make_unique<ManifestPuller>();
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "lib_media/common/file_puller.hpp"
+#include <memory>
+
+// HTTP puller for the manifests, whose refreshes are conditional requests (If-None-Match).
+// A manifest not modified since the last response (304) is served again from that response:
+// the DASH input sees a complete manifest, without its transfer.
+// As the other HTTP pullers, it delivers no data on an error (connection, HTTP 4xx/5xx).
+std::unique_ptr<Modules::In::IFilePuller> createManifestPuller();
@@ -0,0 +1,757 @@
+#include "mp4_index.h"
+#include <algorithm>
+#include <array>
+#include <map>
+#include <stdexcept>
+
+using namespace std;
+
+uint32_t fourccToInt(const char* s)
+{
+  return (uint32_t(uint8_t(s[0])) << 24) | (uint32_t(uint8_t(s[1])) << 16) | (uint32_t(uint8_t(s[2])) << 8) | uint32_t(uint8_t(s[3]));
+}
+
+namespace
+{
+// Bounds-checked big-endian reader over a span of the file.
+struct Reader
+{
+  const uint8_t* ptr;
+  size_t len;
+  size_t pos = 0;
+
+  size_t left() const { return len - pos; }
+
+  void need(size_t n) const
+  {
+    if(n > left())
+      throw runtime_error("truncated MP4 box");
+  }
+
+  uint64_t read(int nbytes)
+  {
+    need(nbytes);
+    uint64_t r = 0;
+
+    for(int i = 0; i < nbytes; ++i)
+      r = (r << 8) | ptr[pos++];
+
+    return r;
+  }
+
+  uint8_t u8() { return (uint8_t)read(1); }
+  uint16_t u16() { return (uint16_t)read(2); }
+  uint32_t u32() { return (uint32_t)read(4); }
+  uint64_t u64() { return read(8); }
+
+  void skip(size_t n)
+  {
+    need(n);
+    pos += n;
+  }
+
+  Reader sub(size_t n)
+  {
+    need(n);
+    Reader r { ptr + pos, n };
+    pos += n;
+    return r;
+  }
+};
+
+struct Box
+{
+  uint32_t type;
+  const uint8_t* start; // first byte of the box header
+  Reader payload;
+};
+
+// Calls 'onBox' for each box contained in 'r'.
+template<typename F>
+void forEachBox(Reader r, F onBox)
+{
+  while(r.left() >= 8)
+  {
+    auto const start = r.ptr + r.pos;
+    uint64_t size = r.u32();
+    auto const type = r.u32();
+    size_t headerSize = 8;
+
+    if(size == 1)
+    {
+      size = r.u64();
+      headerSize = 16;
+    }
+    else if(size == 0)
+      size = r.left() + headerSize;
+
+    if(size < headerSize || size - headerSize > r.left())
+      throw runtime_error("invalid MP4 box size");
+
+    onBox(Box { type, start, r.sub(size - headerSize) });
+  }
+}
+
+// Sample tables, as stored in the 'stbl' box
+struct TrackTables
+{
+  vector<pair<uint32_t, uint32_t>> stts; // (count, delta)
+  vector<pair<uint32_t, int32_t>> ctts; // (count, offset)
+  vector<uint32_t> stss; // 1-based sample numbers
+  bool hasStss = false;
+  vector<array<uint32_t, 2>> stsc; // (first chunk, samples per chunk)
+  vector<uint32_t> sizes;
+  vector<uint64_t> chunkOffsets;
+  int64_t mediaTime = 0; // from the first edit
+};
+
+// Movie fragment defaults, from 'trex'
+struct TrackDefaults
+{
+  uint32_t duration = 0;
+  uint32_t size = 0;
+  uint32_t flags = 0;
+};
+
+// Rejects the sample counts that can't fit in the file, before allocating for them:
+// each sample occupies at least 'sampleSize' bytes (at least one).
+void checkSampleCount(uint64_t count, uint32_t sampleSize, size_t fileSize)
+{
+  if(count > fileSize / max<uint64_t>(sampleSize, 1))
+    throw runtime_error("MP4 sample count exceeds the file size");
+}
+
+bool isSyncFromFlags(uint32_t flags)
+{
+  auto const isNonSync = (flags >> 16) & 1;
+  auto const dependsOn = (flags >> 24) & 3;
+  return !isNonSync && dependsOn != 1;
+}
+
+vector<uint8_t> toVector(Reader r)
+{
+  return vector<uint8_t>(r.ptr, r.ptr + r.len);
+}
+
+// Extracts the DecoderSpecificInfo from an 'esds' box payload.
+vector<uint8_t> parseEsds(Reader r)
+{
+  r.skip(4); // version + flags
+
+  auto readDescriptorSize = [&] ()
+    {
+      uint32_t size = 0;
+
+      for(int i = 0; i < 4; ++i)
+      {
+        auto const b = r.u8();
+        size = (size << 7) | (b & 0x7f);
+
+        if(!(b & 0x80))
+          break;
+      }
+
+      return size;
+    };
+
+  while(r.left() >= 2)
+  {
+    auto const tag = r.u8();
+    auto const size = readDescriptorSize();
+
+    if(tag == 0x03) // ES_Descriptor
+    {
+      auto const flags = (r.skip(2), r.u8());
+
+      if(flags & 0x80)
+        r.skip(2);
+
+      if(flags & 0x40)
+        r.skip(r.u8());
+
+      if(flags & 0x20)
+        r.skip(2);
+    }
+    else if(tag == 0x04) // DecoderConfigDescriptor
+      r.skip(13);
+    else if(tag == 0x05) // DecoderSpecificInfo
+      return toVector(r.sub(size));
+    else
+      r.skip(size);
+  }
+
+  return {};
+}
+
+void parseStsd(Reader r, Mp4Track& track)
+{
+  r.skip(4); // version + flags
+
+  if(r.u32() == 0)
+    return;
+
+  forEachBox(r, [&] (Box entry)
+    {
+      if(!track.fourcc.empty())
+        return; // only the first sample entry is used
+
+      track.fourcc = { char(entry.type >> 24), char(entry.type >> 16), char(entry.type >> 8), char(entry.type) };
+
+      // skip the SampleEntry fields to reach the child boxes
+      size_t fieldsSize = 8;
+
+      if(track.handler == fourccToInt("vide"))
+        fieldsSize += 70;
+      else if(track.handler == fourccToInt("soun"))
+        fieldsSize += 20;
+      else
+        return;
+
+      if(entry.payload.left() < fieldsSize)
+        return;
+
+      entry.payload.skip(fieldsSize);
+      forEachBox(entry.payload, [&] (Box child)
+        {
+          if(!track.dsi.empty())
+            return;
+
+          if(child.type == fourccToInt("esds"))
+            track.dsi = parseEsds(child.payload);
+          else if(child.type == fourccToInt("avcC")
+                  || child.type == fourccToInt("hvcC")
+                  || child.type == fourccToInt("av1C")
+                  || child.type == fourccToInt("vpcC")
+                  || child.type == fourccToInt("dOps"))
+            track.dsi = toVector(child.payload);
+        });
+    });
+}
+
+void parseStbl(Reader r, size_t fileSize, Mp4Track& track, TrackTables& tables)
+{
+  forEachBox(r, [&] (Box box)
+    {
+      auto& p = box.payload;
+
+      if(box.type == fourccToInt("stsd"))
+      {
+        parseStsd(p, track);
+        return;
+      }
+
+      auto const version = p.u8();
+      p.skip(3); // flags
+
+      if(box.type == fourccToInt("stts"))
+      {
+        for(auto n = p.u32(); n > 0; --n)
+        {
+          auto const count = p.u32();
+          tables.stts.push_back({ count, p.u32() });
+        }
+      }
+      else if(box.type == fourccToInt("ctts"))
+      {
+        for(auto n = p.u32(); n > 0; --n)
+        {
+          auto const count = p.u32();
+          auto const offset = p.u32();
+          tables.ctts.push_back({ count, version == 0 ? (int32_t)min(offset, 0x7fffffffu) : (int32_t)offset });
+        }
+      }
+      else if(box.type == fourccToInt("stss"))
+      {
+        tables.hasStss = true;
+
+        for(auto n = p.u32(); n > 0; --n)
+          tables.stss.push_back(p.u32());
+      }
+      else if(box.type == fourccToInt("stsc"))
+      {
+        for(auto n = p.u32(); n > 0; --n)
+        {
+          auto const firstChunk = p.u32();
+          auto const samplesPerChunk = p.u32();
+          p.skip(4); // sample description index
+          tables.stsc.push_back({ firstChunk, samplesPerChunk });
+        }
+      }
+      else if(box.type == fourccToInt("stsz"))
+      {
+        auto const constantSize = p.u32();
+        auto const count = p.u32();
+
+        if(constantSize)
+        {
+          checkSampleCount(count, constantSize, fileSize);
+          tables.sizes.assign(count, constantSize);
+        }
+        else
+          for(uint32_t i = 0; i < count; ++i)
+            tables.sizes.push_back(p.u32());
+      }
+      else if(box.type == fourccToInt("stz2"))
+      {
+        p.skip(3);
+        auto const fieldSize = p.u8();
+        auto const count = p.u32();
+
+        if(fieldSize != 4 && fieldSize != 8 && fieldSize != 16)
+          throw runtime_error("invalid MP4 'stz2' field size");
+
+        for(uint32_t i = 0; i < count; ++i)
+        {
+          if(fieldSize == 4)
+          {
+            auto const b = p.u8();
+            tables.sizes.push_back(b >> 4);
+
+            if(++i < count)
+              tables.sizes.push_back(b & 0xf);
+          }
+          else
+            tables.sizes.push_back((uint32_t)p.read(fieldSize / 8));
+        }
+      }
+      else if(box.type == fourccToInt("stco"))
+      {
+        for(auto n = p.u32(); n > 0; --n)
+          tables.chunkOffsets.push_back(p.u32());
+      }
+      else if(box.type == fourccToInt("co64"))
+      {
+        for(auto n = p.u32(); n > 0; --n)
+        {
+          auto const offset = p.u64();
+
+          // keeps the sample offsets, computed from it, from wrapping around
+          if(offset > fileSize)
+            throw runtime_error("MP4 chunk lies outside of the file");
+
+          tables.chunkOffsets.push_back(offset);
+        }
+      }
+    });
+}
+
+// Expands the 'stbl' tables into a flat list of samples.
+void buildSamples(Mp4Track& track, TrackTables const& t)
+{
+  auto const count = t.sizes.size();
+  track.samples.resize(count);
+
+  // sizes & offsets
+  size_t sampleIdx = 0;
+
+  for(size_t entry = 0; entry < t.stsc.size() && sampleIdx < count; ++entry)
+  {
+    auto const firstChunk = t.stsc[entry][0];
+    auto const lastChunk = entry + 1 < t.stsc.size() ? t.stsc[entry + 1][0] : (uint32_t)t.chunkOffsets.size() + 1;
+
+    for(auto chunk = firstChunk; chunk < lastChunk && sampleIdx < count; ++chunk)
+    {
+      if(chunk == 0 || chunk > t.chunkOffsets.size())
+        throw runtime_error("invalid MP4 chunk index");
+
+      auto offset = t.chunkOffsets[chunk - 1];
+
+      for(uint32_t i = 0; i < t.stsc[entry][1] && sampleIdx < count; ++i)
+      {
+        track.samples[sampleIdx].offset = offset;
+        track.samples[sampleIdx].size = t.sizes[sampleIdx];
+        offset += t.sizes[sampleIdx];
+        ++sampleIdx;
+      }
+    }
+  }
+
+  if(sampleIdx != count)
+    throw runtime_error("inconsistent MP4 sample tables");
+
+  // timestamps
+  {
+    int64_t dts = 0;
+    size_t i = 0;
+
+    for(auto& e : t.stts)
+      for(uint32_t k = 0; k < e.first && i < count; ++k, ++i)
+      {
+        track.samples[i].dts = dts;
+        dts += e.second;
+      }
+
+    for(; i < count; ++i)
+      track.samples[i].dts = dts;
+  }
+
+  {
+    size_t i = 0;
+
+    for(auto& e : t.ctts)
+      for(uint32_t k = 0; k < e.first && i < count; ++k, ++i)
+        track.samples[i].pts = track.samples[i].dts + e.second;
+
+    for(; i < count; ++i)
+      track.samples[i].pts = track.samples[i].dts;
+
+    for(auto& s : track.samples)
+      s.pts -= t.mediaTime;
+  }
+
+  // random access points
+  for(auto& s : track.samples)
+    s.sync = !t.hasStss;
+
+  for(auto num : t.stss)
+    if(num >= 1 && num <= count)
+      track.samples[num - 1].sync = true;
+}
+
+void parseTrak(Reader r, size_t fileSize, Mp4Track& track, TrackTables& tables)
+{
+  forEachBox(r, [&] (Box box)
+    {
+      auto& p = box.payload;
+
+      if(box.type == fourccToInt("tkhd"))
+      {
+        auto const version = p.u8();
+        p.skip(3 + (version == 1 ? 16 : 8));
+        track.id = p.u32();
+      }
+      else if(box.type == fourccToInt("edts"))
+      {
+        forEachBox(p, [&] (Box elst)
+          {
+            if(elst.type != fourccToInt("elst"))
+              return;
+
+            auto& e = elst.payload;
+            auto const version = e.u8();
+            e.skip(3);
+
+            for(auto n = e.u32(); n > 0; --n)
+            {
+              e.skip(version == 1 ? 8 : 4); // segment duration
+              auto const mediaTime = version == 1 ? (int64_t)e.u64() : (int64_t)(int32_t)e.u32();
+              e.skip(4); // rate
+
+              if(mediaTime >= 0)
+              {
+                tables.mediaTime = mediaTime;
+                break;
+              }
+            }
+          });
+      }
+      else if(box.type == fourccToInt("mdia"))
+      {
+        forEachBox(p, [&] (Box child)
+          {
+            auto& c = child.payload;
+
+            if(child.type == fourccToInt("mdhd"))
+            {
+              auto const version = c.u8();
+              c.skip(3 + (version == 1 ? 16 : 8));
+              track.timescale = c.u32();
+            }
+            else if(child.type == fourccToInt("hdlr"))
+            {
+              c.skip(8);
+              track.handler = c.u32();
+            }
+            else if(child.type == fourccToInt("minf"))
+            {
+              forEachBox(c, [&] (Box stbl)
+                {
+                  if(stbl.type == fourccToInt("stbl"))
+                    parseStbl(stbl.payload, fileSize, track, tables);
+                });
+            }
+          });
+      }
+    });
+}
+
+void parseMoof(Box moof, const uint8_t* fileStart, size_t fileSize, vector<Mp4Track>& tracks, map<uint32_t, TrackDefaults> const& defaults)
+{
+  auto const moofOffset = (uint64_t)(moof.start - fileStart);
+
+  forEachBox(moof.payload, [&] (Box traf)
+    {
+      if(traf.type != fourccToInt("traf"))
+        return;
+
+      Mp4Track* track = nullptr;
+      TrackDefaults def;
+      uint64_t baseOffset = moofOffset;
+      int64_t dts = -1;
+      uint64_t nextOffset = 0;
+      bool hasNextOffset = false;
+
+      forEachBox(traf.payload, [&] (Box box)
+        {
+          auto& p = box.payload;
+          auto const version = p.u8();
+          uint32_t const flags = (uint32_t)p.read(3);
+
+          if(box.type == fourccToInt("tfhd"))
+          {
+            auto const id = p.u32();
+
+            for(auto& t : tracks)
+              if(t.id == id)
+                track = &t;
+
+            auto i = defaults.find(id);
+
+            if(i != defaults.end())
+              def = i->second;
+
+            if(flags & 0x01)
+            {
+              baseOffset = p.u64();
+
+              if(baseOffset > fileSize)
+                throw runtime_error("MP4 track fragment lies outside of the file");
+            }
+
+            if(flags & 0x02)
+              p.skip(4); // sample description index
+
+            if(flags & 0x08)
+              def.duration = p.u32();
+
+            if(flags & 0x10)
+              def.size = p.u32();
+
+            if(flags & 0x20)
+              def.flags = p.u32();
+          }
+          else if(box.type == fourccToInt("tfdt"))
+          {
+            dts = version == 1 ? (int64_t)p.u64() : (int64_t)p.u32();
+          }
+          else if(box.type == fourccToInt("trun"))
+          {
+            if(!track)
+              return;
+
+            if(dts < 0)
+              dts = track->samples.empty() ? 0 : track->samples.back().dts + def.duration;
+
+            auto const count = p.u32();
+            uint64_t offset = hasNextOffset ? nextOffset : baseOffset;
+
+            if(flags & 0x001)
+            {
+              auto const dataOffset = (int64_t)(int32_t)p.u32();
+
+              if(dataOffset < 0 && (uint64_t)-dataOffset > baseOffset)
+                throw runtime_error("MP4 sample data lies before the start of the file");
+
+              offset = baseOffset + dataOffset;
+            }
+
+            auto firstFlags = def.flags;
+            bool hasFirstFlags = false;
+
+            if(flags & 0x004)
+            {
+              firstFlags = p.u32();
+              hasFirstFlags = true;
+            }
+
+            // without per-sample fields, nothing but the file size bounds 'count'
+            size_t perSampleBytes = 0;
+
+            for(uint32_t field = 0x100; field <= 0x800; field <<= 1)
+              perSampleBytes += (flags & field) ? 4 : 0;
+
+            if(perSampleBytes && count > p.left() / perSampleBytes)
+              throw runtime_error("truncated MP4 'trun' box");
+
+            checkSampleCount(track->samples.size() + count, (flags & 0x200) ? 0 : def.size, fileSize);
+
+            for(uint32_t i = 0; i < count; ++i)
+            {
+              Mp4Sample s {};
+              auto const duration = (flags & 0x100) ? p.u32() : def.duration;
+              s.size = (flags & 0x200) ? p.u32() : def.size;
+              auto const sampleFlags = (flags & 0x400) ? p.u32() : (i == 0 && hasFirstFlags ? firstFlags : def.flags);
+              auto const cto = (flags & 0x800) ? (version == 0 ? (int64_t)p.u32() : (int64_t)(int32_t)p.u32()) : 0;
+
+              s.offset = offset;
+              s.dts = dts;
+              s.pts = dts + cto;
+              s.sync = isSyncFromFlags(sampleFlags);
+              track->samples.push_back(s);
+
+              offset += s.size;
+              dts += duration;
+            }
+
+            nextOffset = offset;
+            hasNextOffset = true;
+          }
+        });
+    });
+}
+}
+
+Mp4FragmentStart parseFragmentStart(const uint8_t* moof, size_t size)
+{
+  Mp4FragmentStart r;
+  bool found = false;
+
+  forEachBox(Reader { moof, size }, [&] (Box box)
+    {
+      if(box.type != fourccToInt("moof"))
+        throw runtime_error("not a 'moof' box");
+
+      forEachBox(box.payload, [&] (Box traf)
+        {
+          if(traf.type != fourccToInt("traf") || found)
+            return;
+
+          found = true;
+          bool firstRun = true;
+
+          forEachBox(traf.payload, [&] (Box child)
+            {
+              auto& p = child.payload;
+              auto const version = p.u8();
+              uint32_t const flags = (uint32_t)p.read(3);
+
+              if(child.type == fourccToInt("tfhd"))
+              {
+                p.skip(4); // track id
+                p.skip((flags & 0x01) ? 8 : 0); // base data offset
+                p.skip((flags & 0x02) ? 4 : 0); // sample description index
+                p.skip((flags & 0x08) ? 4 : 0); // default duration
+                p.skip((flags & 0x10) ? 4 : 0); // default size
+
+                if(flags & 0x20)
+                  r.sap = isSyncFromFlags(p.u32());
+              }
+              else if(child.type == fourccToInt("tfdt"))
+              {
+                r.decodeTime = version == 1 ? (int64_t)p.u64() : (int64_t)p.u32();
+              }
+              else if(child.type == fourccToInt("trun") && firstRun)
+              {
+                if(!p.u32())
+                  return; // no samples
+
+                firstRun = false;
+
+                p.skip((flags & 0x001) ? 4 : 0); // data offset
+
+                if(flags & 0x004)
+                {
+                  r.sap = isSyncFromFlags(p.u32());
+                  return;
+                }
+
+                p.skip((flags & 0x100) ? 4 : 0); // first sample duration
+                p.skip((flags & 0x200) ? 4 : 0); // first sample size
+
+                if(flags & 0x400)
+                  r.sap = isSyncFromFlags(p.u32());
+              }
+            });
+        });
+    });
+
+  return r;
+}
+
+vector<Mp4Track> parseMp4Index(const uint8_t* data, size_t size)
+{
+  vector<Mp4Track> tracks;
+  vector<TrackTables> tables;
+  map<uint32_t, TrackDefaults> defaults;
+  bool foundMoov = false;
+
+  forEachBox(Reader { data, size }, [&] (Box top)
+    {
+      if(top.type == fourccToInt("moov"))
+      {
+        foundMoov = true;
+        forEachBox(top.payload, [&] (Box box)
+          {
+            if(box.type == fourccToInt("trak"))
+            {
+              tracks.push_back({});
+              tables.push_back({});
+              parseTrak(box.payload, size, tracks.back(), tables.back());
+              buildSamples(tracks.back(), tables.back());
+            }
+            else if(box.type == fourccToInt("mvex"))
+            {
+              forEachBox(box.payload, [&] (Box trex)
+                {
+                  if(trex.type != fourccToInt("trex"))
+                    return;
+
+                  auto& p = trex.payload;
+                  p.skip(4);
+                  auto const id = p.u32();
+                  p.skip(4); // sample description index
+                  auto& d = defaults[id];
+                  d.duration = p.u32();
+                  d.size = p.u32();
+                  d.flags = p.u32();
+                });
+            }
+          });
+      }
+      else if(top.type == fourccToInt("moof"))
+      {
+        if(!foundMoov)
+          throw runtime_error("'moof' found before 'moov'");
+
+        parseMoof(top, data, size, tracks, defaults);
+      }
+    });
+
+  if(!foundMoov)
+    throw runtime_error("no 'moov' box found");
+
+  for(auto& t : tracks)
+  {
+    if(t.timescale == 0)
+      throw runtime_error("invalid MP4 track timescale");
+
+    for(size_t i = 0; i < t.samples.size(); ++i)
+    {
+      auto const& s = t.samples[i];
+
+      if(s.offset > size || s.size > size - s.offset)
+        throw runtime_error("MP4 sample lies outside of the file");
+
+      if(s.sync)
+        t.syncPoints.push_back({ s.pts, i });
+    }
+
+    sort(t.syncPoints.begin(), t.syncPoints.end());
+  }
+
+  return tracks;
+}
+
+size_t findSyncSample(Mp4Track const& track, int64_t pts)
+{
+  if(track.syncPoints.empty())
+    return 0;
+
+  auto i = upper_bound(track.syncPoints.begin(), track.syncPoints.end(), pts,
+                       [] (int64_t val, pair<int64_t, size_t> const& p) { return val < p.first; });
+
+  if(i != track.syncPoints.begin())
+    --i;
+
+  return i->second;
+}
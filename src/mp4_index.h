@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Sample tables of an ISOBMFF file (MP4), built once from the 'moov' box
+// and from the 'moof' boxes of fragmented files.
+// Only the box structure is read: the sample payloads are never touched.
+
+struct Mp4Sample
+{
+  uint64_t offset; // absolute position of the payload in the file
+  uint32_t size;
+  int64_t dts; // in track timescale units
+  int64_t pts; // in track timescale units
+  bool sync;
+};
+
+struct Mp4Track
+{
+  uint32_t id = 0;
+  uint32_t timescale = 0;
+  uint32_t handler = 0; // e.g 'vide', 'soun'
+  std::string fourcc; // sample entry type, e.g "avc1"
+  std::vector<uint8_t> dsi; // decoder specific info (e.g avcC payload)
+
+  std::vector<Mp4Sample> samples; // in decoding order
+  std::vector<std::pair<int64_t, size_t>> syncPoints; // (pts, sample index), sorted by pts
+};
+
+std::vector<Mp4Track> parseMp4Index(const uint8_t* data, size_t size);
+
+// Returns the index of the last sync sample whose pts is lower or equal to 'pts'
+// (or of the first sync sample, if there is none). O(log n).
+size_t findSyncSample(Mp4Track const& track, int64_t pts);
+
+// Start of a movie fragment, read from its 'moof' box (of its first track fragment).
+struct Mp4FragmentStart
+{
+  int64_t decodeTime = -1; // 'tfdt', in track timescale units. -1 if absent
+  bool sap = true; // the first sample is a sync sample. Assumed when its flags aren't in the fragment
+};
+
+// 'moof' points to the whole box, header included. Throws if it's malformed.
+Mp4FragmentStart parseFragmentStart(const uint8_t* moof, size_t size);
+
+uint32_t fourccToInt(const char* s);
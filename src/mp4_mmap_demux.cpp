@@ -0,0 +1,202 @@
+#include "mp4_mmap_demux.h"
+#include "lib_media/common/attributes.hpp"
+#include "tracer.h"
+#include <stdexcept>
+
+using namespace Modules;
+using namespace std;
+
+// Counts the frames sent and not yet released
+struct MmapPendingFrames
+{
+  void add()
+  {
+    unique_lock<mutex> lock(m);
+    ++count;
+  }
+
+  void remove()
+  {
+    unique_lock<mutex> lock(m);
+    --count;
+    released.notify_one();
+  }
+
+  // Returns false if there was still no room after 'timeout'.
+  bool waitForRoom(int maxCount, chrono::milliseconds timeout)
+  {
+    unique_lock<mutex> lock(m);
+    return released.wait_for(lock, timeout, [&] () { return count < maxCount; });
+  }
+
+  mutex m;
+  condition_variable released;
+  int count = 0;
+};
+
+namespace
+{
+// A sample living inside the file mapping.
+// Keeps the mapping alive as long as the frame is referenced.
+struct DataMapped : DataBase
+{
+  DataMapped(shared_ptr<FileMapping> file_, shared_ptr<MmapPendingFrames> pending_, SpanC span_, int epoch_)
+    : file(file_), pending(pending_), span(span_), epoch(epoch_)
+  {
+    pending->add();
+  }
+
+  ~DataMapped()
+  {
+    pending->remove();
+  }
+
+  Span data() override { throw runtime_error("DataMapped is read-only"); }
+  SpanC data() const override { return span; }
+  void resize(size_t) override { throw runtime_error("DataMapped can't be resized"); }
+
+  shared_ptr<FileMapping> const file;
+  shared_ptr<MmapPendingFrames> const pending;
+  SpanC const span;
+  int const epoch;
+};
+
+StreamType getStreamType(uint32_t handler)
+{
+  if(handler == fourccToInt("vide"))
+    return VIDEO_PKT;
+
+  if(handler == fourccToInt("soun"))
+    return AUDIO_PKT;
+
+  return SUBTITLE_PKT;
+}
+
+int64_t toClock(int64_t t, uint32_t timescale)
+{
+  return t * IClock::Rate / timescale;
+}
+}
+
+Mp4MmapDemux::Mp4MmapDemux(KHost* host, Mp4MmapDemuxConfig const& cfg)
+  : m_host(host),
+  m_file(mapFile(cfg.path.c_str())),
+  m_pending(make_shared<MmapPendingFrames>()),
+  m_maxPendingFrames(cfg.maxPendingFrames),
+  m_readAhead(cfg.readAhead),
+  m_epoch(0)
+{
+  for(auto& t : parseMp4Index(m_file->data(), m_file->size()))
+  {
+    if(t.samples.empty())
+      continue;
+
+    auto meta = make_shared<MetadataPkt>(getStreamType(t.handler));
+    meta->codec = t.fourcc;
+    meta->codecSpecificInfo = t.dsi;
+
+    Track track;
+    track.index = move(t);
+    track.output = addOutput();
+    track.output->setMetadata(meta);
+    track.meta = meta;
+    // a frame leaves the pending count right before its block returns to the pool:
+    // leave room for the frames being released concurrently.
+    track.pool = make_shared<BlockPool>(m_maxPendingFrames + 2);
+    m_tracks.push_back(move(track));
+  }
+
+  if(m_tracks.empty())
+    throw runtime_error("no samples found in '" + cfg.path + "'");
+
+  if(cfg.seekControlCbk)
+    cfg.seekControlCbk(this);
+
+  if(cfg.poolStatsCbk)
+    cfg.poolStatsCbk(this);
+
+  m_host->activate(true);
+}
+
+void Mp4MmapDemux::seek(int64_t timeInMs)
+{
+  unique_lock<mutex> lock(m_mutex);
+  m_seekTarget = timeInMs;
+  m_seekPending = true;
+  ++m_epoch;
+  m_seekRequested.notify_one();
+}
+
+bool Mp4MmapDemux::isStale(Data const& data) const
+{
+  auto mapped = dynamic_cast<const DataMapped*>(data.get());
+  return mapped && mapped->epoch != m_epoch;
+}
+
+void Mp4MmapDemux::getPoolStats(int outputIndex, uint64_t& allocations, uint64_t& exhaustions) const
+{
+  if(outputIndex < 0 || outputIndex >= (int)m_tracks.size())
+    throw runtime_error("invalid output index");
+
+  auto& pool = *m_tracks[outputIndex].pool;
+  allocations = pool.allocations;
+  exhaustions = pool.exhaustions;
+}
+
+void Mp4MmapDemux::process()
+{
+  // backpressure: don't read further than what downstream is able to hold
+  if(!m_pending->waitForRoom(m_maxPendingFrames, chrono::milliseconds(50)))
+    return;
+
+  unique_lock<mutex> lock(m_mutex);
+
+  if(m_seekPending)
+  {
+    m_seekPending = false;
+
+    for(auto& t : m_tracks)
+      t.next = findSyncSample(t.index, m_seekTarget * t.index.timescale / 1000);
+
+    m_prefetchedUntil = 0;
+  }
+
+  // Send the samples in file order: this keeps the page faults sequential.
+  Track* track = nullptr;
+
+  for(auto& t : m_tracks)
+    if(t.next < t.index.samples.size())
+      if(!track || t.index.samples[t.next].offset < track->index.samples[track->next].offset)
+        track = &t;
+
+  if(!track)
+  {
+    m_seekRequested.wait_for(lock, chrono::milliseconds(50));
+    return;
+  }
+
+  auto const demuxStart = chrono::steady_clock::now();
+  auto const& s = track->index.samples[track->next++];
+
+  if(s.offset + s.size > m_prefetchedUntil)
+  {
+    m_file->prefetch(s.offset, m_readAhead);
+    m_prefetchedUntil = s.offset + m_readAhead;
+  }
+
+  // steady state: the frame and its control block live in a recycled block
+  auto data = allocate_shared<DataMapped>(BlockAllocator<DataMapped>(track->pool), m_file, m_pending, SpanC { m_file->data() + s.offset, s.size }, m_epoch);
+  lock.unlock();
+
+  data->setMetadata(track->meta);
+  data->set(PresentationTime { toClock(s.pts, track->index.timescale) });
+  data->set(DecodingTime { toClock(s.dts, track->index.timescale) });
+
+  CueFlags flags {};
+  flags.keyframe = s.sync;
+  data->set(flags);
+
+  track->output->post(data);
+
+  traceSpan("demux", "sample", demuxStart, chrono::steady_clock::now(), -1, track->index.fourcc.c_str());
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "lib_modules/utils/helper.hpp"
+#include "lib_media/common/metadata.hpp"
+#include "block_pool.h"
+#include "filemap.h"
+#include "mp4_index.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Repositions a running demuxer.
+struct ISeekControl
+{
+  virtual ~ISeekControl() = default;
+
+  // Resumes from the nearest sync sample preceding 'timeInMs'. Thread-safe.
+  virtual void seek(int64_t timeInMs) = 0;
+
+  // Tells if 'data' was sent before the last call to 'seek'.
+  virtual bool isStale(Modules::Data const& data) const = 0;
+};
+
+// Buffer usage of a running demuxer.
+struct IPoolStats
+{
+  virtual ~IPoolStats() = default;
+
+  // Counts the buffers allocated past the preallocated ones. Thread-safe.
+  virtual void getPoolStats(int outputIndex, uint64_t& allocations, uint64_t& exhaustions) const = 0;
+};
+
+struct Mp4MmapDemuxConfig
+{
+  std::string path;
+
+  // How far ahead of the read position the OS is asked to page-in the file.
+  size_t readAhead = 8 * 1024 * 1024;
+
+  // Maximum number of frames sent but not yet released downstream.
+  // Past this, the demuxer waits: this bounds the memory used by a consumer
+  // slower than the disk.
+  // As many frame buffers are preallocated per output, and recycled.
+  int maxPendingFrames = 64;
+
+  std::function<void(ISeekControl*)> seekControlCbk;
+  std::function<void(IPoolStats*)> poolStatsCbk;
+};
+
+struct MmapPendingFrames;
+
+// Zero-copy demuxer for local MP4 files.
+// The file is mapped once and its sample tables are indexed at creation:
+// the output frames point straight into the mapping, so delivering a frame
+// only costs page faults and the memory footprint is the page cache.
+// At the end of the file, the demuxer stays idle until the next seek.
+struct Mp4MmapDemux : Modules::Module, ISeekControl, IPoolStats
+{
+  Mp4MmapDemux(Modules::KHost* host, Mp4MmapDemuxConfig const& cfg);
+  void process() override;
+
+  void seek(int64_t timeInMs) override;
+  bool isStale(Modules::Data const& data) const override;
+
+  void getPoolStats(int outputIndex, uint64_t& allocations, uint64_t& exhaustions) const override;
+
+  private:
+    struct Track
+    {
+      Mp4Track index;
+      size_t next = 0; // next sample to be sent
+      Modules::KOutput* output;
+      std::shared_ptr<const Modules::MetadataPkt> meta;
+      std::shared_ptr<BlockPool> pool; // recycles the frames
+    };
+
+    Modules::KHost* const m_host;
+    std::shared_ptr<FileMapping> m_file;
+    std::shared_ptr<MmapPendingFrames> m_pending;
+    int const m_maxPendingFrames;
+    size_t const m_readAhead;
+    size_t m_prefetchedUntil = 0;
+    std::vector<Track> m_tracks;
+
+    std::mutex m_mutex; // protects below members
+    std::condition_variable m_seekRequested;
+    bool m_seekPending = false;
+    int64_t m_seekTarget = 0;
+    std::atomic<int> m_epoch; // incremented at each seek
+};
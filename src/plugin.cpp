@@ -2,10 +2,16 @@
 #include "lldash_play.h"
 
 #include <cstdio>
+#include <cstdlib> // getenv
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
 #include <mutex>
-#include <queue>
+#include <vector>
+#include <thread>
 #include <cstring> // memcpy
+#include <algorithm>
 
 #include "lib_pipeline/pipeline.hpp"
 #include "lib_utils/format.hpp"
@@ -13,12 +19,22 @@
 
 // modules
 #include "lib_media/common/attributes.hpp"
+#include "lib_media/common/http_puller.hpp" // createHttpSource
 #include "lib_media/common/metadata.hpp" // MetadataPkt
 #include "lib_media/demux/dash_demux.hpp"
 #include "lib_media/demux/gpac_demux_mp4_simple.hpp"
 #include "lib_media/demux/libav_demux.hpp"
 #include "lib_media/in/mpeg_dash_input.hpp"
 #include "lib_media/out/null.hpp"
+#include "annexb.h"
+#include "download_scheduler.h"
+#include "filemap.h"
+#include "manifest_puller.h"
+#include "mp4_mmap_demux.h"
+#include "probe.h"
+#include "shm_ring.h"
+#include "thread_policy.h"
+#include "tracer.h"
 
 using namespace Modules;
 using namespace Pipelines;
@@ -28,6 +44,22 @@ using namespace std;
 // Helpers
 ///////////////////////////////////////////////////////////////////////////////
 
+static auto const DefaultPacingLookaheadMs = 100;
+static auto const MaxPacingDrift = chrono::seconds(2);
+static auto const DefaultFrameSetDeadlineMs = 100;
+static auto const DefaultFramesPerStream = 64;
+static auto const DefaultStallTimeoutMs = 3000;
+static auto const DefaultMinBackoffMs = 500;
+static auto const DefaultMaxBackoffMs = 8000;
+static auto const SupervisionPeriod = chrono::milliseconds(100);
+static auto const JitterDelayFactor = 4; // playout delay, in units of the estimated jitter
+static auto const JitterWindow = chrono::seconds(5); // of the smallest transit
+static auto const MaxProbeCacheEntries = 64u; // see lldplay_probe
+
+// Options of the libav input, for LLDPLAY_LIBAV_LOW_LATENCY:
+// probe the least data possible, and hand the packets over as soon as they're read.
+static auto const LibavLowLatencyOptions = "-probesize 32 -analyzeduration 0 -fflags nobuffer -flags low_delay -avioflags direct -max_delay 0";
+
 static
 bool startsWith(string s, string prefix)
 {
@@ -63,6 +95,289 @@ struct Logger : LogSink
   std::function<void(const char*, int level)> onError = nullptr;
 };
 
+// Releases the frames according to their presentation time, against the wallclock.
+// Frames are released up to 'lookahead' before they're due.
+// Holding the frames back holds back the demuxer (backpressure).
+// Each source has its own timeline, rate and pause state, hence its own anchor:
+// e.g a local file paced in real-time next to an unpaced live source.
+struct Pacer
+{
+  // Maps the presentation times of a source to the wallclock. Protected by the pacer mutex.
+  struct Anchor
+  {
+    double speed = 0; // 0 means 'as fast as possible'
+    chrono::milliseconds lookahead {};
+    bool held = false;
+    bool dropHeld = false;
+
+    int generation = -1; // valid while equal to the pacer 'anchorGeneration'
+    int64_t pts = 0;
+    chrono::steady_clock::time_point time;
+  };
+
+  void configure(Anchor& anchor, double speed, int lookaheadMs)
+  {
+    unique_lock<mutex> lock(m);
+    anchor.speed = speed;
+    anchor.lookahead = chrono::milliseconds(lookaheadMs);
+    anchor.generation = -1;
+    wakeup.notify_all();
+  }
+
+  // Blocks until the frame presented at 'pts' (in IClock::Rate units) is due.
+  // Returns false for a frame held by a pause whose release asked to drop it.
+  bool wait(Anchor& anchor, int64_t pts)
+  {
+    unique_lock<mutex> lock(m);
+
+    if(anchor.held)
+    {
+      wakeup.wait(lock, [&] () { return !anchor.held || stopped; });
+
+      if(anchor.dropHeld)
+        return false;
+    }
+
+    while(anchor.speed > 0 && !stopped)
+    {
+      auto const now = chrono::steady_clock::now();
+
+      if(anchor.generation != anchorGeneration)
+      {
+        anchor.generation = anchorGeneration;
+        anchor.pts = pts;
+        anchor.time = now;
+        return true;
+      }
+
+      auto const mediaDelta = chrono::duration<double>(double(pts - anchor.pts) / IClock::Rate);
+      auto const due = anchor.time + chrono::duration_cast<chrono::steady_clock::duration>(mediaDelta / anchor.speed) - anchor.lookahead;
+
+      // discontinuity (seek, loop, stalled consumer...): restart the clock from here
+      if(due > now + MaxPacingDrift || due < now - MaxPacingDrift)
+      {
+        anchor.generation = -1;
+        continue;
+      }
+
+      if(due <= now)
+        return true;
+
+      // until due, or until the clock restarts (reset, reconfiguration)
+      wakeup.wait_until(lock, due, [&] () { return stopped || anchor.generation != anchorGeneration; });
+
+      if(anchor.generation == anchorGeneration)
+        return true;
+    }
+
+    return true;
+  }
+
+  // Restarts the clocks of all the sources from their next frame, e.g after a seek.
+  void reset()
+  {
+    unique_lock<mutex> lock(m);
+    ++anchorGeneration;
+    wakeup.notify_all();
+  }
+
+  // Blocks the delivery of a source (hence its demuxer, through the pipeline backpressure) until 'release'.
+  void hold(Anchor& anchor)
+  {
+    unique_lock<mutex> lock(m);
+    anchor.held = true;
+  }
+
+  // Releases the held frames of a source, or drops them if 'drop' is set. Restarts its clock.
+  void release(Anchor& anchor, bool drop)
+  {
+    unique_lock<mutex> lock(m);
+    anchor.held = false;
+    anchor.dropHeld = drop;
+    anchor.generation = -1;
+    wakeup.notify_all();
+  }
+
+  // Releases the waiting frames, and disables pacing for good.
+  void stop()
+  {
+    unique_lock<mutex> lock(m);
+    stopped = true;
+    wakeup.notify_all();
+  }
+
+  mutex m;
+  condition_variable wakeup;
+  bool stopped = false;
+  int anchorGeneration = 0;
+};
+
+// Adaptive playout delay (see lldplay_set_jitter_buffer).
+// The playout clock maps the presentation times to the local time: a frame is due at its
+// presentation time, plus the smallest recent transit (arrival - presentation time),
+// plus a delay following the arrival jitter (RFC 3550 estimator), within [minDelay, maxDelay].
+// Each source has its own clock (see 'Timeline'): their presentation times may be unrelated.
+// Must be called with 'transferMutex' locked.
+struct JitterBuffer
+{
+  // Clock of one source
+  struct Timeline
+  {
+    int generation = -1; // valid while equal to the buffer 'generation'
+    chrono::microseconds minTransit {};
+    chrono::microseconds prevMinTransit {};
+    chrono::microseconds lastTransit {};
+    chrono::steady_clock::time_point windowStart;
+    double jitterUs = 0;
+    chrono::microseconds delay {};
+
+    chrono::microseconds getBaseTransit() const { return min(minTransit, prevMinTransit); }
+  };
+
+  void configure(int minDelayMs, int maxDelayMs)
+  {
+    minDelay = chrono::milliseconds(minDelayMs);
+    maxDelay = chrono::milliseconds(maxDelayMs);
+    reset();
+  }
+
+  bool enabled() const { return maxDelay.count() > 0; }
+
+  // Returns when the frame presented at 'pts' (in IClock::Rate units) is due.
+  chrono::steady_clock::time_point onArrival(Timeline& t, int64_t pts, chrono::steady_clock::time_point arrival)
+  {
+    if(!enabled())
+      return arrival;
+
+    auto const presentation = chrono::duration_cast<chrono::microseconds>(chrono::duration<double>(double(pts) / IClock::Rate));
+    auto const transit = chrono::duration_cast<chrono::microseconds>(arrival.time_since_epoch()) - presentation;
+
+    // first frame, or discontinuity (seek, loop, reconnection...): restart the clock from here
+    if(t.generation != generation || transit > t.getBaseTransit() + MaxPacingDrift || transit < t.getBaseTransit() - MaxPacingDrift)
+    {
+      t.generation = generation;
+      t.minTransit = t.prevMinTransit = t.lastTransit = transit;
+      t.windowStart = arrival;
+      t.jitterUs = 0;
+      t.delay = minDelay;
+    }
+
+    t.jitterUs += (abs(double((transit - t.lastTransit).count())) - t.jitterUs) / 16;
+    t.lastTransit = transit;
+
+    // smallest transit over the last one or two windows: follows the clock drift
+    if(arrival - t.windowStart > JitterWindow)
+    {
+      t.prevMinTransit = t.minTransit;
+      t.minTransit = transit;
+      t.windowStart = arrival;
+    }
+
+    t.minTransit = min(t.minTransit, transit);
+
+    // grows at once (avoids late frames), shrinks slowly (avoids release gaps)
+    auto const target = max<chrono::microseconds>(minDelay, min<chrono::microseconds>(maxDelay, chrono::microseconds(int64_t(JitterDelayFactor * t.jitterUs))));
+    t.delay = target > t.delay ? target : t.delay - (t.delay - target) / 64;
+
+    auto const due = chrono::steady_clock::time_point(chrono::duration_cast<chrono::steady_clock::duration>(presentation + t.getBaseTransit() + t.delay));
+
+    anchored = true;
+    lastPts = pts;
+    lastDue = due;
+    lastDelay = t.delay;
+    lastJitterUs = t.jitterUs;
+
+    if(due < arrival)
+    {
+      ++lateFrames;
+      return arrival;
+    }
+
+    return due;
+  }
+
+  // Restarts the clocks of all the sources from their next frame, e.g after a seek.
+  void reset()
+  {
+    anchored = false;
+    ++generation;
+  }
+
+  chrono::milliseconds minDelay {};
+  chrono::milliseconds maxDelay {}; // zero: disabled
+
+  int generation = 0;
+  uint64_t lateFrames = 0; // all sources
+
+  // mapping of the last frame received (of any source), for lldplay_get_playout_clock
+  bool anchored = false;
+  int64_t lastPts = 0;
+  chrono::steady_clock::time_point lastDue;
+  chrono::microseconds lastDelay {};
+  double lastJitterUs = 0;
+};
+
+// FIFO over preallocated slots: pushing and popping don't allocate.
+// When full, the capacity doubles: this allocates, and is counted.
+template<typename T>
+struct Ring
+{
+  void reserve(size_t capacity)
+  {
+    if(capacity > slots.size())
+      grow(capacity);
+  }
+
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+  size_t capacity() const { return slots.size(); }
+
+  T& front() { return slots[head]; }
+  T& at(size_t i) { return slots[(head + i) % slots.size()]; }
+
+  // Sequence number of 'front()': the count of popped elements.
+  uint64_t frontSeq() const { return popped; }
+
+  void pop()
+  {
+    slots[head] = T(); // release the frame now
+    head = (head + 1) % slots.size();
+    --count;
+    ++popped;
+  }
+
+  void push(T&& val)
+  {
+    if(count == slots.size())
+    {
+      grow(max<size_t>(1, slots.size() * 2));
+      ++growths;
+    }
+
+    slots[(head + count) % slots.size()] = move(val);
+    ++count;
+  }
+
+  uint64_t growths = 0;
+
+  private:
+    void grow(size_t capacity)
+    {
+      vector<T> bigger(capacity);
+
+      for(size_t i = 0; i < count; ++i)
+        bigger[i] = move(slots[(head + i) % slots.size()]);
+
+      slots.swap(bigger);
+      head = 0;
+    }
+
+    vector<T> slots;
+    size_t head = 0;
+    size_t count = 0;
+    uint64_t popped = 0;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // API
 ///////////////////////////////////////////////////////////////////////////////
@@ -76,8 +391,32 @@ struct lldplay_handle
 
   ~lldplay_handle()
   {
+    if(teardownThread.joinable())
+      teardownThread.join();
+
+    if(!tornDown)
+      teardown();
+
+    if(tracing)
+      traceStop();
+  }
+
+  // Stops the supervisor, the pacer and the pipeline. Blocking: see lldplay_stop.
+  void teardown()
+  {
+    // stop reconnecting the sources
+    {
+      unique_lock<mutex> lock(transferMutex);
+      supervisorStop = true;
+      supervisorWakeup.notify_one();
+    }
+
+    if(supervisor.joinable())
+      supervisor.join();
+
     // prevent queuing further data buffers
     dropEverything = true;
+    pacer.stop();
 
     // release all data buffers (= unblock potential calls to 'alloc' inside the pipeline)
     {
@@ -88,39 +427,201 @@ struct lldplay_handle
           s.fifo.pop();
     }
 
-    // destroy the pipeline
-    pipe.reset();
+    // destroy the pipeline (not while a source is being added)
+    {
+      unique_lock<mutex> control(controlMutex);
+      pipe.reset();
+    }
   }
 
-  void adaptationControlCbk(IAdaptationControl* i)
-  {
-    adaptationControl = i;
-  }
+  Logger logger;
 
-  IAdaptationControl* adaptationControl = nullptr;
+  bool tracing = false; // the running trace was started by this handle
 
-  Logger logger;
+  Pacer pacer;
+
+  // set by lldplay_set_pacing, for all the sources. Protected by 'controlMutex'
+  bool pacingConfigured = false;
+  double pacingSpeed = 0;
+  int pacingLookaheadMs = 0;
+
+  chrono::milliseconds frameSetDeadline = chrono::milliseconds(DefaultFrameSetDeadlineMs);
+
+  Pipeline::Threading threading = Pipeline::OneThreadPerModule;
+  ThreadPolicy threadPolicy;
+  int framesPerStream = DefaultFramesPerStream;
+
+  // for the sources read by libav (see isLibavUrl), protected by 'controlMutex'
+  int libavProfile = LLDPLAY_LIBAV_DEFAULT;
+  string libavOptions;
+
+  // A demuxer and its output stubs. All the sources share the same pipeline.
+  struct Source
+  {
+    int id;
+    string url;
+    bool isNetwork = false;
+    IFilter* demux = nullptr; // replaced when reconnecting
+    vector<IFilter*> stubs;
+    IAdaptationControl* adaptationControl = nullptr;
+    IAdaptationControl* nextAdaptationControl = nullptr; // of the demuxer being created when reconnecting
+    unique_ptr<Modules::In::IFilePullerFactory> pullerFactory; // must outlive 'demux'
+    int firstTile = 0;
+    ISeekControl* seekControl = nullptr;
+    IPoolStats* poolStats = nullptr;
+    atomic<bool> removed { false };
+
+    // own timeline: the sources of a session may be unrelated
+    Pacer::Anchor pacingAnchor;
+    JitterBuffer::Timeline jitterTimeline; // protected by 'transferMutex'
+
+    // range of public stream indices
+    int firstStreamIndex = 0;
+    int streamCount = 0;
+
+    // outage tracking, protected by 'transferMutex'
+    chrono::steady_clock::time_point lastFrame;
+    chrono::steady_clock::time_point added;
+    chrono::steady_clock::duration timeToFirstFrame {}; // zero until the first frame
+    bool inOutage = false;
+    chrono::steady_clock::time_point outageStart;
+    chrono::steady_clock::duration outageDuration {}; // of the finished outages
+    uint32_t reconnections = 0;
+    chrono::steady_clock::time_point nextRetry;
+    chrono::milliseconds backoff {};
+  };
+
+  // In-place recovery of the network sources:
+  // a source delivering no frame for 'stallTimeout' gets a new demuxer,
+  // retrying with an exponential backoff.
+  struct ReconnectPolicy
+  {
+    chrono::milliseconds stallTimeout { DefaultStallTimeoutMs }; // zero disables reconnection
+    chrono::milliseconds minBackoff { DefaultMinBackoffMs };
+    chrono::milliseconds maxBackoff { DefaultMaxBackoffMs };
+  };
 
+  // One per demuxer output (i.e per tile, for DASH sources)
   struct Stream
   {
-    queue<Data> fifo;
+    struct Frame
+    {
+      Data data;
+      chrono::steady_clock::time_point arrival;
+      uint64_t id; // for tracing
+      chrono::steady_clock::time_point due; // see JitterBuffer
+    };
+
+    Ring<Frame> fifo; // shared by the consumers: a frame is popped once all of them read it
+    uint64_t cursor = 0; // of the default consumer, sequence number in 'fifo'
+    uint64_t framesReceived = 0;
     string fourcc;
+    bool enabled = true;
+
+    // Unsubscribed streams are dropped at the demuxer output, before any locking.
+    // Shared with the output stub of the stream.
+    shared_ptr<atomic<bool>> subscribed = make_shared<atomic<bool>>(true);
+    int quality = 0; // last enabled quality
+    Source* source = nullptr; // null once the source is removed
+    int sourceOutput = 0; // output index in the source demuxer (i.e the adaptation set)
+
+    int frameFormat = LLDPLAY_FRAME_FORMAT_AS_IS;
+    unique_ptr<ShmRingWriter> exporter; // replaces 'fifo' when set
+
+    // quality switch measurement: from the request to the first frame of the new quality
+    bool switchPending = false;
+    bool switchNeedsNewMetadata = false; // false when the tile was disabled: any frame completes the switch
+    chrono::steady_clock::time_point switchRequest;
+    shared_ptr<const IMetadata> lastMetadata; // changes with the representation
+    uint32_t switches = 0;
+    uint32_t fastSwitches = 0;
+    chrono::steady_clock::duration lastSwitchLatency {};
+    chrono::steady_clock::duration maxSwitchLatency {};
+    NalConfig nalConfig;
+    vector<uint8_t> nalConfigDsi; // the DSI 'nalConfig' was parsed from
+
+    // from 'lldplay_resume' to the first frame
+    bool resumePending = false;
+    chrono::steady_clock::duration lastResumeLatency {};
+  };
+
+  // A reader of the streams with its own cursors (see lldplay_add_consumer).
+  struct Consumer
+  {
+    struct Cursor
+    {
+      uint64_t next = 0; // sequence number in the 'fifo' of the stream
+      uint64_t framesRead = 0;
+      uint64_t framesDropped = 0;
+    };
+
+    Cursor& at(int tile)
+    {
+      if(tile >= (int)cursors.size())
+        cursors.resize(tile + 1);
+
+      return cursors[tile];
+    }
+
+    int id;
+    size_t maxLag;
+    vector<Cursor> cursors; // per stream, grown on demand
+  };
+
+  // Public stream index: one per representation of each tile
+  struct StreamRef
+  {
+    int tile; // index in 'streams'
+    int quality;
   };
 
   std::function<bool(const char*)> errorCbk;
   atomic<bool> dropEverything;
+
+  // serializes the changes of the source demuxers (add, remove, reconnect, stream selection).
+  // Must be locked before 'transferMutex'.
+  mutex controlMutex;
+
+  thread supervisor; // reconnects the network sources
+
+  // bounded-time stop (see lldplay_stop)
+  atomic<bool> stopRequested { false };
+  thread teardownThread;
+  mutex teardownMutex; // protects below members
+  condition_variable teardownDone;
+  bool tornDown = false;
+  bool deleteWhenTornDown = false; // lldplay_destroy gave up waiting: the teardown thread owns the handle
+
+  DownloadScheduler scheduler { createHttpSource, createManifestPuller };
+
   mutex transferMutex; // protects below members
   vector<Stream> streams;
+  vector<StreamRef> streamRefs;
+  vector<shared_ptr<Source>> sources;
+  int nextSourceId = 0;
+  vector<Consumer> consumers;
+  int nextConsumerId = 1;
+  bool defaultConsumer = true; // the one of 'lldplay_grab_frame' and 'lldplay_grab_frameset'
+  JitterBuffer jitterBuffer;
+  bool started = false;
+  ReconnectPolicy reconnect;
+  condition_variable supervisorWakeup;
+  bool supervisorStop = false;
+  bool paused = false; // see lldplay_pause
+  chrono::steady_clock::time_point resumed;
   unique_ptr<Pipeline> pipe;
 };
 
-lldplay_handle* lldplay_create(const char* name, LLDashPlayoutMessageCallback onError, int maxLevel, uint64_t api_version)
+lldplay_handle* lldplay_create(const char* name, LLDashPlayoutMessageCallback onError, int maxLevel, uint64_t api_version, const LLDashPlayoutOptions* options)
 {
   try
   {
     if(api_version != LLDASH_PLAYOUT_API_VERSION)
       throw runtime_error(format("Inconsistent API version between compilation (%s) and runtime (%s). Aborting.", LLDASH_PLAYOUT_API_VERSION, api_version).c_str());
 
+    if(options && options->version != LLDASH_PLAYOUT_OPTIONS_VERSION)
+      throw runtime_error(format("Inconsistent options version between compilation (%s) and runtime (%s). Aborting.", LLDASH_PLAYOUT_OPTIONS_VERSION, options->version).c_str());
+
     if(!name)
       name = "UnnamedPipeline";
 
@@ -135,6 +636,31 @@ lldplay_handle* lldplay_create(const char* name, LLDashPlayoutMessageCallback on
     };
     setGlobalLogger(h->logger);
 
+    if(auto tracePath = getenv("LLDPLAY_TRACE"))
+      h->tracing = traceStart(tracePath);
+
+    if(options)
+    {
+      switch(options->threading)
+      {
+      case LLDPLAY_THREADING_ONE_PER_MODULE: h->threading = Pipeline::OneThreadPerModule; break;
+      case LLDPLAY_THREADING_SINGLE: h->threading = Pipeline::Mono; break;
+      default: throw runtime_error(format("Unknown threading mode %s", options->threading).c_str());
+      }
+
+      if(options->threadPriority < -20 || options->threadPriority > 19)
+        throw runtime_error("Thread priority must be in [-20;19]");
+
+      h->threadPolicy.cpuMask = options->cpuAffinityMask;
+      h->threadPolicy.priority = options->threadPriority;
+
+      if(options->framesPerStream < 0)
+        throw runtime_error("Frames per stream can't be negative");
+
+      if(options->framesPerStream)
+        h->framesPerStream = options->framesPerStream;
+    }
+
     return h.release();
   }
   catch(exception const& err)
@@ -150,12 +676,88 @@ lldplay_handle* lldplay_create(const char* name, LLDashPlayoutMessageCallback on
   }
 }
 
+// Upper bound of the time spent in lldplay_destroy.
+static auto const DestroyTimeoutMs = 2000;
+
+// The teardowns lldplay_destroy gave up waiting for, see lldplay_wait_teardown.
+static struct
+{
+  mutex threadsMutex; // protects below members
+  condition_variable done;
+  vector<thread> threads;
+  int running = 0;
+} backgroundTeardowns;
+
+bool lldplay_stop(lldplay_handle* h, int timeoutMs)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(!h->stopRequested.exchange(true))
+    {
+      // cooperative cancellation: unblock the pending and future downloads,
+      // the waiting frames, and the queuing of new ones.
+      h->scheduler.abortAll();
+      h->dropEverything = true;
+      h->pacer.stop();
+
+      h->teardownThread = thread([h] ()
+        {
+          h->teardown();
+
+          unique_lock<mutex> lock(h->teardownMutex);
+          h->tornDown = true;
+          h->teardownDone.notify_all();
+
+          if(h->deleteWhenTornDown)
+          {
+            lock.unlock();
+            delete h;
+
+            lock_guard<mutex> bgLock(backgroundTeardowns.threadsMutex);
+            --backgroundTeardowns.running;
+            backgroundTeardowns.done.notify_all();
+          }
+        });
+    }
+
+    unique_lock<mutex> lock(h->teardownMutex);
+    return h->teardownDone.wait_for(lock, chrono::milliseconds(max(0, timeoutMs)), [h] () { return h->tornDown; });
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
 void lldplay_destroy(lldplay_handle* h)
 {
   try
   {
-    for (int i=0; i<lldplay_get_stream_count(h); ++i)
-      lldplay_disable_stream(h, i);
+    if(!h)
+      return;
+
+    lldplay_stop(h, DestroyTimeoutMs);
+
+    {
+      unique_lock<mutex> lock(h->teardownMutex);
+
+      if(!h->tornDown)
+      {
+        // don't block the caller any longer: the teardown thread will delete the handle
+        h->logger.log(Level::Warning, format("[%s] teardown still running after %sms: finishing in the background\n", __func__, DestroyTimeoutMs).c_str());
+        h->deleteWhenTornDown = true;
+
+        lock_guard<mutex> bgLock(backgroundTeardowns.threadsMutex);
+        ++backgroundTeardowns.running;
+        backgroundTeardowns.threads.push_back(move(h->teardownThread));
+        return;
+      }
+    }
+
     delete h;
   }
   catch(exception const& err)
@@ -170,6 +772,35 @@ void lldplay_destroy(lldplay_handle* h)
   }
 }
 
+bool lldplay_wait_teardown(int timeoutMs)
+{
+  try
+  {
+    vector<thread> threads;
+
+    {
+      unique_lock<mutex> lock(backgroundTeardowns.threadsMutex);
+
+      if(!backgroundTeardowns.done.wait_for(lock, chrono::milliseconds(max(0, timeoutMs)), [] () { return backgroundTeardowns.running == 0; }))
+        return false;
+
+      threads.swap(backgroundTeardowns.threads);
+    }
+
+    // they are past the teardown: only their exit is left
+    for(auto& t : threads)
+      t.join();
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    fprintf(stderr, "[%s] exception caught: %s\n", __func__, err.what());
+    fflush(stderr);
+    return false;
+  }
+}
+
 int lldplay_get_stream_count(lldplay_handle* h)
 {
   try
@@ -180,17 +811,8 @@ int lldplay_get_stream_count(lldplay_handle* h)
     if(!h->pipe)
       throw runtime_error("Can only get stream count when the pipeline is playing");
 
-    if(h->adaptationControl)
-    {
-      int num = 0;
-
-      for(int as = 0; as < h->adaptationControl->getNumAdaptationSets(); ++as)
-        num += h->adaptationControl->getNumRepresentationsInAdaptationSet(as);
-
-      return num;
-    }
-    else
-      return (int)h->streams.size();
+    unique_lock<mutex> lock(h->transferMutex);
+    return (int)h->streamRefs.size();
   }
   catch(exception const& err)
   {
@@ -199,19 +821,26 @@ int lldplay_get_stream_count(lldplay_handle* h)
   }
 }
 
+// Returns the tile of a public stream index.
+// Must be called with 'transferMutex' locked.
 static int get_stream_index(lldplay_handle* h, int i)
 {
-  if(h->adaptationControl)
-  {
-    for(int as = 0; as < h->adaptationControl->getNumAdaptationSets(); ++as)
-      for(int rep = 0; rep < h->adaptationControl->getNumRepresentationsInAdaptationSet(as); --i, ++rep)
-        if(i == 0)
-          return as;
-  }
-  else
-    return i;
+  if(i < 0 || i >= (int)h->streamRefs.size())
+    throw runtime_error("Invalid stream index.");
+
+  return h->streamRefs[i].tile;
+}
+
+// e.g "0,1,0,1,1,2,2". An empty SRD leaves the fields to zero.
+static bool parseSrd(string const& srd, StreamDesc* desc)
+{
+  if(srd.empty())
+    return true;
+
+  auto const parsed = sscanf(srd.c_str(), "0,%u,%u,%u,%u,%u,%u",
+                             &desc->objectX, &desc->objectY, &desc->objectWidth, &desc->objectHeight, &desc->totalWidth, &desc->totalHeight);
 
-  throw runtime_error("Invalid stream index.");
+  return parsed == 6;
 }
 
 bool lldplay_get_stream_info(lldplay_handle* h, int streamIndex, struct StreamDesc* desc)
@@ -224,50 +853,32 @@ bool lldplay_get_stream_info(lldplay_handle* h, int streamIndex, struct StreamDe
     if(!h->pipe)
       throw runtime_error("Can only get stream 4CC when the pipeline is playing");
 
-    if(streamIndex < 0 || streamIndex >= lldplay_get_stream_count(h))
-      throw runtime_error("Invalid streamIndex: must be positive and inferior to the number of streams");
-
     if(!desc)
       throw runtime_error("desc can't be NULL");
 
-    auto const streamFirstIndex = get_stream_index(h, streamIndex);
+    unique_lock<mutex> lock(h->transferMutex);
+
+    if(streamIndex < 0 || streamIndex >= (int)h->streamRefs.size())
+      throw runtime_error("Invalid streamIndex: must be positive and inferior to the number of streams");
+
+    auto const& stream = h->streams[get_stream_index(h, streamIndex)];
 
-    if(h->streams[streamIndex].fourcc.size() > 4) {
-      h->logger.log(Level::Warning, format("[%s] 4CC \"%s\" will be truncated\n", __func__, h->streams[streamFirstIndex].fourcc.c_str()).c_str());
+    if(stream.fourcc.size() > 4) {
+      h->logger.log(Level::Warning, format("[%s] 4CC \"%s\" will be truncated\n", __func__, stream.fourcc.c_str()).c_str());
 
     }
     *desc = {};
-    memcpy(&desc->MP4_4CC, h->streams[streamFirstIndex].fourcc.c_str(), 4);
+    memcpy(&desc->MP4_4CC, stream.fourcc.c_str(), min<size_t>(stream.fourcc.size(), 4));
 
-    if(h->adaptationControl)
+    if(stream.source && stream.source->adaptationControl)
     {
-      int i = 0, as = 0, rep = 0;
+      auto srd = stream.source->adaptationControl->getSRD(stream.sourceOutput);
 
-      for(as = 0; as < h->adaptationControl->getNumAdaptationSets(); ++as)
+      if(!parseSrd(srd, desc))
       {
-        for(rep = 0; rep < h->adaptationControl->getNumRepresentationsInAdaptationSet(as); ++i, ++rep)
-        {
-          if(i == streamIndex)
-          {
-            auto srd = h->adaptationControl->getSRD(as);
-
-            if(!srd.empty())
-            {
-              auto const parsed = sscanf(srd.c_str(), "0,%u,%u,%u,%u,%u,%u",
-                                         &desc->objectX, &desc->objectY, &desc->objectWidth, &desc->objectHeight, &desc->totalWidth, &desc->totalHeight);
-
-              if(parsed != 6)
-              {
-                h->logger.log(Level::Error, format("[%s] Invalid SRD format: \"%s\"\n", __func__, srd.c_str()).c_str());
-                return false;
-              }
-            }
-            return true;
-          }
-        }
+        h->logger.log(Level::Error, format("[%s] Invalid SRD format: \"%s\"\n", __func__, srd.c_str()).c_str());
+        return false;
       }
-
-      return false;
     }
 
     return true;
@@ -279,80 +890,1839 @@ bool lldplay_get_stream_info(lldplay_handle* h, int streamIndex, struct StreamDe
   }
 }
 
-bool lldplay_play(lldplay_handle* h, const char* url)
+bool lldplay_get_stream_stats(lldplay_handle* h, int streamIndex, struct StreamStats* stats)
 {
   try
   {
     if(!h)
       throw runtime_error("handle can't be NULL");
 
-    if(!url)
-      throw runtime_error("URL can't be NULL");
-
-    h->pipe = make_unique<Pipeline>(&h->logger);
+    if(!stats)
+      throw runtime_error("stats can't be NULL");
 
-    auto& pipe = *h->pipe;
-
-    pipe.registerErrorCallback(h->errorCbk);
+    unique_lock<mutex> lock(h->transferMutex);
 
-    auto addStream = [&] (OutputPin p)
-      {
-        auto const idx = (int)h->streams.size();
-        h->streams.push_back({});
-        auto meta = dynamic_pointer_cast<const MetadataPkt>(p.mod->getOutputMetadata(p.index));
+    auto const& stream = h->streams[get_stream_index(h, streamIndex)];
 
-        if(meta)
-          h->streams[idx].fourcc = meta->codec;
+    *stats = {};
+    stats->framesReceived = stream.framesReceived;
+    stats->queuedFrames = (uint32_t)(stream.fifo.frontSeq() + stream.fifo.size() - max(stream.cursor, stream.fifo.frontSeq()));
+    stats->queueCapacity = (uint32_t)stream.fifo.capacity();
+    stats->allocations = stream.fifo.growths;
+    stats->switches = stream.switches;
+    stats->fastSwitches = stream.fastSwitches;
+    stats->lastSwitchLatencyMs = (uint64_t)chrono::duration_cast<chrono::milliseconds>(stream.lastSwitchLatency).count();
+    stats->maxSwitchLatencyMs = (uint64_t)chrono::duration_cast<chrono::milliseconds>(stream.maxSwitchLatency).count();
+    stats->lastResumeLatencyMs = (uint64_t)chrono::duration_cast<chrono::milliseconds>(stream.lastResumeLatency).count();
 
-        auto onFrame = [idx, h] (Data data)
-          {
-            if(h->dropEverything)
-              return;
+    if(stream.source && stream.source->poolStats)
+    {
+      uint64_t allocations = 0, exhaustions = 0;
+      stream.source->poolStats->getPoolStats(stream.sourceOutput, allocations, exhaustions);
+      stats->allocations += allocations;
+      stats->poolExhaustions += exhaustions;
+    }
 
-            if(isDeclaration(data))
-              return;
+    if(auto src = stream.source)
+    {
+      auto outage = src->outageDuration;
 
-            unique_lock<mutex> lock(h->transferMutex);
-            h->streams[idx].fifo.push(data);
-          };
+      if(src->inOutage)
+        outage += chrono::steady_clock::now() - src->outageStart;
 
-        auto name = string("stream #") + to_string(idx);
-        auto render = pipe.addNamedModule<OutStub>(name.c_str(), onFrame);
-        pipe.connect(p, render);
+      stats->reconnections = src->reconnections;
+      stats->outageDurationMs = (uint64_t)chrono::duration_cast<chrono::milliseconds>(outage).count();
+      stats->outage = src->inOutage;
+      stats->timeToFirstFrameMs = (uint64_t)chrono::duration_cast<chrono::milliseconds>(src->timeToFirstFrame).count();
+    }
 
-        fprintf(stderr, "Added: %s\n", name.c_str());
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+static bool hasThreadPolicy(lldplay_handle* h)
+{
+  return h->threadPolicy.cpuMask || h->threadPolicy.priority;
+}
+
+// Contribution feeds, read by libav. The other network sources are DASH.
+static bool isLibavUrl(string const& url)
+{
+  for(auto scheme : { "rtmp://", "rtsp://", "srt://", "udp://", "tcp://", "rtp://" })
+    if(startsWith(url, scheme))
+      return true;
+
+  return false;
+}
+
+static bool isNetworkUrl(string const& url)
+{
+  return startsWith(url, "http://") || startsWith(url, "https://") || isLibavUrl(url);
+}
+
+// Creates the demuxer of a network source.
+// 'adaptationControl' receives the adaptation control of DASH sources.
+// 'pullerFactory' receives the scheduled HTTP pullers of DASH sources.
+static IFilter* createNetworkDemux(lldplay_handle* h, int firstTile, string const& url, IAdaptationControl** adaptationControl, unique_ptr<Modules::In::IFilePullerFactory>& pullerFactory)
+{
+  auto& pipe = *h->pipe;
+
+  if(isLibavUrl(url))
+  {
+    DemuxConfig cfg;
+    cfg.url = url;
+
+    if(h->libavProfile == LLDPLAY_LIBAV_LOW_LATENCY)
+    {
+      cfg.avformatCustom = LibavLowLatencyOptions;
+
+      // with almost no probing, the container must be known upfront
+      if(startsWith(url, "udp://") || startsWith(url, "srt://") || startsWith(url, "tcp://"))
+        cfg.formatName = "mpegts";
+    }
+
+    if(!h->libavOptions.empty())
+      cfg.avformatCustom += (cfg.avformatCustom.empty() ? "" : " ") + h->libavOptions;
+
+    return pipe.add("LibavDemux", &cfg);
+  }
+
+  pullerFactory = h->scheduler.createFactory(firstTile);
+
+  DashDemuxConfig cfg;
+  cfg.url = url;
+  cfg.filePullerFactory = pullerFactory.get();
+  cfg.adaptationControlCbk = [adaptationControl] (IAdaptationControl* i) { *adaptationControl = i; };
+  return pipe.add("DashDemuxer", &cfg);
+}
+
+static void superviseSources(lldplay_handle* h);
+static void exportFrame(lldplay_handle::Stream& stream, Data const& data);
+static void enforceMaxLags(lldplay_handle* h, int tile);
+
+// Must be called from a thread having the pipeline thread policy.
+static lldplay_handle::Source* addSourceUnsafe(lldplay_handle* h, const char* url)
+{
+  if(!h->pipe)
+  {
+    h->pipe = make_unique<Pipeline>(&h->logger, false, h->threading);
+    h->pipe->registerErrorCallback(h->errorCbk);
+  }
+
+  auto& pipe = *h->pipe;
+
+  auto source = make_shared<lldplay_handle::Source>();
+  auto src = source.get();
+  src->id = h->nextSourceId++;
+  src->url = url;
+  src->isNetwork = isNetworkUrl(url);
+  src->lastFrame = chrono::steady_clock::now();
+  src->added = src->lastFrame;
+
+  {
+    unique_lock<mutex> lock(h->transferMutex);
+    src->firstTile = (int)h->streams.size();
+  }
+
+  // before the first frame. By default, local files are paced in real-time and network sources aren't paced
+  if(h->pacingConfigured)
+    h->pacer.configure(src->pacingAnchor, h->pacingSpeed, h->pacingLookaheadMs);
+  else if(!src->isNetwork)
+    h->pacer.configure(src->pacingAnchor, 1.0, DefaultPacingLookaheadMs);
+
+  // added while paused: waits for the resume, as the other sources
+  if(h->paused)
+    h->pacer.hold(src->pacingAnchor);
+
+  if(src->isNetwork)
+  {
+    src->demux = createNetworkDemux(h, src->firstTile, url, &src->adaptationControl, src->pullerFactory);
+  }
+  else
+  {
+    try
+    {
+      Mp4MmapDemuxConfig cfg;
+      cfg.path = url;
+      cfg.seekControlCbk = [src] (ISeekControl* i) { src->seekControl = i; };
+      cfg.poolStatsCbk = [src] (IPoolStats* i) { src->poolStats = i; };
+      cfg.maxPendingFrames = h->framesPerStream;
+      src->demux = pipe.addNamedModule<Mp4MmapDemux>("Mp4MmapDemux", cfg);
+    }
+    catch(exception const& err)
+    {
+      h->logger.log(Level::Warning, format("[%s] can't index '%s' (%s), falling back to GPACDemuxMP4Simple\n", __func__, url, err.what()).c_str());
+
+      Mp4DemuxConfig cfg;
+      cfg.path = url;
+      src->demux = pipe.add("GPACDemuxMP4Simple", &cfg);
+    }
+  }
+
+  auto const numOutputs = src->demux->getNumOutputs();
+  int firstTile = 0;
+  vector<shared_ptr<atomic<bool>>> subscriptions;
+
+  {
+    unique_lock<mutex> lock(h->transferMutex);
+
+    firstTile = (int)h->streams.size();
+    src->firstStreamIndex = (int)h->streamRefs.size();
+
+    for(int k = 0; k < numOutputs; ++k)
+    {
+      lldplay_handle::Stream stream;
+      stream.source = src;
+      stream.sourceOutput = k;
+      stream.fifo.reserve(h->framesPerStream);
+
+      auto meta = dynamic_pointer_cast<const MetadataPkt>(src->demux->getOutputMetadata(k));
+
+      if(meta)
+        stream.fourcc = meta->codec;
+
+      auto const tile = (int)h->streams.size();
+      subscriptions.push_back(stream.subscribed);
+      h->streams.push_back(move(stream));
+
+      if(src->adaptationControl)
+      {
+        for(int rep = 0; rep < src->adaptationControl->getNumRepresentationsInAdaptationSet(k); ++rep)
+          h->streamRefs.push_back({ tile, rep });
+      }
+      else
+        h->streamRefs.push_back({ tile, 0 });
+    }
+
+    src->streamCount = (int)h->streamRefs.size() - src->firstStreamIndex;
+  }
+
+  for(int k = 0; k < numOutputs; ++k)
+  {
+    auto const idx = firstTile + k;
+    auto const subscribed = subscriptions[k];
+
+    auto onFrame = [idx, h, src, subscribed] (Data data)
+      {
+        if(h->dropEverything || src->removed)
+          return;
+
+        if(isDeclaration(data))
+          return;
+
+        if(!*subscribed)
+          return;
+
+        auto const received = chrono::steady_clock::now();
+
+        // for the systems where threads don't inherit the policy of their creator
+        static thread_local bool threadPolicyApplied = false;
+
+        if(!threadPolicyApplied && hasThreadPolicy(h))
+        {
+          setThreadPolicy(h->threadPolicy);
+          threadPolicyApplied = true;
+        }
+
+        if(src->seekControl && src->seekControl->isStale(data))
+          return;
+
+        // held across a resume at the live edge: obsolete
+        if(!h->pacer.wait(src->pacingAnchor, data->get<PresentationTime>().time))
+          return;
+
+        if(isTracing())
+          traceSpan("delivery", "pacing", received, chrono::steady_clock::now(), idx);
+
+        if(h->dropEverything || src->removed)
+          return;
+
+        unique_lock<mutex> lock(h->transferMutex);
+
+        // the stream table might have been rebuilt meanwhile (lldplay_switch)
+        if(src->removed)
+          return;
+
+        if(src->seekControl && src->seekControl->isStale(data))
+          return;
+
+        // demuxed before the pause
+        if(h->paused)
+          return;
+
+        auto const now = chrono::steady_clock::now();
+        auto& stream = h->streams[idx];
+        auto const meta = data->getMetadata();
+
+        if(stream.resumePending)
+        {
+          stream.resumePending = false;
+          stream.lastResumeLatency = now - h->resumed;
+          traceSpan("control", "resume", h->resumed, now, idx);
+        }
+
+        // mid-segment, the metadata only changes at the next segment
+        auto const fastSwitched = stream.switchPending && stream.switchNeedsNewMetadata && h->scheduler.takeSwitched(idx);
+
+        if(stream.switchPending && (!stream.switchNeedsNewMetadata || meta != stream.lastMetadata || fastSwitched))
+        {
+          stream.switchPending = false;
+          stream.fastSwitches += fastSwitched ? 1 : 0;
+          stream.lastSwitchLatency = now - stream.switchRequest;
+          stream.maxSwitchLatency = max(stream.maxSwitchLatency, stream.lastSwitchLatency);
+          ++stream.switches;
+          traceSpan("control", "switch", stream.switchRequest, now, idx);
+        }
+
+        stream.lastMetadata = meta;
+
+        if(stream.exporter)
+        {
+          try
+          {
+            exportFrame(stream, data);
+          }
+          catch(exception const& err)
+          {
+            h->logger.log(Level::Warning, format("stream #%s: can't export a frame (%s), dropping it", idx, err.what()).c_str());
+          }
+        }
+        else
+        {
+          auto const due = h->jitterBuffer.onArrival(src->jitterTimeline, data->get<PresentationTime>().time, now);
+          stream.fifo.push({ data, now, (uint64_t)idx << 40 | stream.framesReceived, due });
+          enforceMaxLags(h, idx);
+        }
+
+        ++stream.framesReceived;
+
+        traceSpan("delivery", "enqueue", received, now, idx);
+
+        src->lastFrame = now;
+
+        if(src->timeToFirstFrame == chrono::steady_clock::duration::zero())
+          src->timeToFirstFrame = now - src->added;
+
+        if(src->inOutage)
+        {
+          src->inOutage = false;
+          src->outageDuration += now - src->outageStart;
+          h->logger.log(Level::Info, format("source #%s: frames are flowing again", src->id).c_str());
+        }
+      };
+
+    auto name = string("stream #") + to_string(idx);
+    auto render = pipe.addNamedModule<OutStub>(name.c_str(), onFrame);
+    pipe.connect(GetOutputPin(src->demux, k), render);
+    src->stubs.push_back(render);
+
+    fprintf(stderr, "Added: %s\n", name.c_str());
+  }
+
+  // modules added later to a running pipeline are started by the pipeline itself
+  if(!h->started)
+  {
+    pipe.start();
+    h->started = true;
+  }
+
+  if(src->isNetwork && !h->supervisor.joinable())
+    h->supervisor = thread(superviseSources, h);
+
+  unique_lock<mutex> lock(h->transferMutex);
+  h->sources.push_back(move(source));
+
+  return src;
+}
+
+// Runs 'f' from a thread having the scheduling policy of the pipeline,
+// so the pipeline threads it creates inherit it.
+// This doesn't touch the policy of the calling thread (most likely one of the host application).
+static void runWithThreadPolicy(lldplay_handle* h, function<void()> f)
+{
+  if(!hasThreadPolicy(h))
+  {
+    f();
+    return;
+  }
+
+  exception_ptr error;
+
+  thread t([&]()
+    {
+      if(!setThreadPolicy(h->threadPolicy))
+        h->logger.log(Level::Warning, format("[runWithThreadPolicy] can't fully apply the thread policy (affinity mask=%s, priority=%s)\n", h->threadPolicy.cpuMask, h->threadPolicy.priority).c_str());
+
+      try
+      {
+        f();
+      }
+      catch(...)
+      {
+        error = current_exception();
+      }
+    });
+
+  t.join();
+
+  if(error)
+    rethrow_exception(error);
+}
+
+// Adds a demuxer for 'url' and its output stubs to the pipeline.
+// Creates and starts the pipeline on the first call.
+static lldplay_handle::Source* addSource(lldplay_handle* h, const char* url)
+{
+  if(!url)
+    throw runtime_error("URL can't be NULL");
+
+  unique_lock<mutex> control(h->controlMutex);
+
+  if(h->stopRequested)
+    throw runtime_error("The handle was stopped");
+
+  lldplay_handle::Source* r = nullptr;
+  runWithThreadPolicy(h, [&]() { r = addSourceUnsafe(h, url); });
+  return r;
+}
+
+// Replaces the demuxer of a stalled source by a new one, keeping its output stubs
+// (hence the stream indices). For live sources, the new demuxer starts at the live edge.
+static void reconnectSource(lldplay_handle* h, lldplay_handle::Source* src)
+{
+  auto scheduleRetry = [&] ()
+    {
+      unique_lock<mutex> lock(h->transferMutex);
+      src->nextRetry = chrono::steady_clock::now() + src->backoff;
+      src->backoff = min(src->backoff * 2, h->reconnect.maxBackoff);
+    };
+
+  // the pipeline, the libav settings and the source itself may be changed concurrently
+  // by the API calls: the new demuxer is created under 'controlMutex' too.
+  unique_lock<mutex> control(h->controlMutex);
+
+  if(src->removed || h->stopRequested)
+    return;
+
+  unique_ptr<Modules::In::IFilePullerFactory> pullerFactory;
+  IFilter* demux = nullptr;
+
+  try
+  {
+    demux = createNetworkDemux(h, src->firstTile, src->url, &src->nextAdaptationControl, pullerFactory);
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Warning, format("source #%s: can't reconnect (%s), retrying in %sms", src->id, err.what(), (int)src->backoff.count()).c_str());
+    scheduleRetry();
+    return;
+  }
+
+  if(demux->getNumOutputs() != (int)src->stubs.size())
+  {
+    h->logger.log(Level::Error, format("source #%s: the stream layout changed (%s streams instead of %s), can't resume", src->id, demux->getNumOutputs(), src->stubs.size()).c_str());
+    h->pipe->removeModule(demux);
+    scheduleRetry();
+    return;
+  }
+
+  for(int k = 0; k < (int)src->stubs.size(); ++k)
+  {
+    h->pipe->disconnect(src->demux, k, src->stubs[k], 0);
+    h->pipe->connect(GetOutputPin(demux, k), src->stubs[k]);
+  }
+
+  h->pipe->removeModule(src->demux);
+  src->demux = demux;
+  src->pullerFactory = move(pullerFactory);
+
+  // restore the stream selection
+  struct Selection
+  {
+    int as;
+    bool enabled; // and subscribed
+    int quality;
+  };
+
+  vector<Selection> selections;
+
+  {
+    unique_lock<mutex> lock(h->transferMutex);
+    src->adaptationControl = src->nextAdaptationControl;
+
+    for(auto& stream : h->streams)
+      if(stream.source == src)
+        selections.push_back({ stream.sourceOutput, stream.enabled && *stream.subscribed, stream.quality });
+
+    ++src->reconnections;
+
+    // give the new demuxer some time before retrying
+    src->nextRetry = chrono::steady_clock::now() + h->reconnect.stallTimeout + src->backoff;
+    src->backoff = min(src->backoff * 2, h->reconnect.maxBackoff);
+  }
+
+  if(src->adaptationControl)
+  {
+    for(auto& sel : selections)
+    {
+      if(sel.enabled)
+        src->adaptationControl->enableStream(sel.as, sel.quality);
+      else
+        src->adaptationControl->disableStream(sel.as);
+    }
+  }
+
+  h->logger.log(Level::Info, format("source #%s: reconnected", src->id).c_str());
+}
+
+// Detects the stalled network sources, and reconnects them.
+static void superviseSources(lldplay_handle* h)
+{
+  unique_lock<mutex> lock(h->transferMutex);
+
+  while(!h->supervisorStop)
+  {
+    h->supervisorWakeup.wait_for(lock, SupervisionPeriod);
+
+    // a paused source isn't expected to deliver anything
+    if(h->supervisorStop || h->paused || !h->reconnect.stallTimeout.count())
+      continue;
+
+    auto const now = chrono::steady_clock::now();
+    vector<shared_ptr<lldplay_handle::Source>> stalled;
+
+    for(auto& src : h->sources)
+    {
+      if(!src->isNetwork || src->removed)
+        continue;
+
+      if(!src->inOutage)
+      {
+        if(now - src->lastFrame < h->reconnect.stallTimeout)
+          continue;
+
+        // a source whose streams are all disabled isn't expected to deliver anything
+        bool anyEnabled = false;
+
+        for(auto& stream : h->streams)
+          if(stream.source == src.get() && stream.enabled)
+            anyEnabled = true;
+
+        if(!anyEnabled)
+          continue;
+
+        src->inOutage = true;
+        src->outageStart = src->lastFrame;
+        src->backoff = h->reconnect.minBackoff;
+        src->nextRetry = now;
+
+        h->logger.log(Level::Warning, format("source #%s: no frame received for %sms, reconnecting", src->id, (int)h->reconnect.stallTimeout.count()).c_str());
+      }
+
+      if(now >= src->nextRetry)
+        stalled.push_back(src);
+    }
+
+    lock.unlock();
+
+    for(auto& src : stalled)
+      reconnectSource(h, src.get());
+
+    lock.lock();
+  }
+}
+
+bool lldplay_play(lldplay_handle* h, const char* url)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(h->pipe)
+      throw runtime_error("Already playing: use lldplay_add_source to play more URLs");
+
+    addSource(h, url);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+int lldplay_add_source(lldplay_handle* h, const char* url)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    return addSource(h, url)->id;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return -1;
+  }
+}
+
+static lldplay_handle::Source* findSource(lldplay_handle* h, int sourceId)
+{
+  for(auto& src : h->sources)
+    if(src->id == sourceId)
+      return src.get();
+
+  throw runtime_error("Unknown source");
+}
+
+// Marks a source as removed, and detaches its streams: from there, nothing reaches
+// its modules through the streams (e.g its pool stats or its adaptation control).
+// The stream indices stay valid, but won't receive any more frames.
+// Must be called with 'transferMutex' locked, before removing the modules.
+static void detachSource(lldplay_handle* h, lldplay_handle::Source* src)
+{
+  src->removed = true;
+
+  for(auto& stream : h->streams)
+  {
+    if(stream.source != src)
+      continue;
+
+    stream.source = nullptr;
+    stream.enabled = false;
+
+    while(!stream.fifo.empty())
+      stream.fifo.pop();
+  }
+}
+
+// Removes the demuxer and the output stubs of a source from the pipeline.
+// Must be called with 'controlMutex' locked, once the source is marked as removed.
+static void removeSourceModules(lldplay_handle* h, lldplay_handle::Source* src)
+{
+  for(int k = 0; k < (int)src->stubs.size(); ++k)
+  {
+    h->pipe->disconnect(src->demux, k, src->stubs[k], 0);
+    h->pipe->removeModule(src->stubs[k]);
+  }
+
+  h->pipe->removeModule(src->demux);
+
+  // the interfaces of the demuxer died with it
+  src->seekControl = nullptr;
+  src->poolStats = nullptr;
+}
+
+bool lldplay_remove_source(lldplay_handle* h, int sourceId)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    unique_lock<mutex> control(h->controlMutex);
+    lldplay_handle::Source* src = nullptr;
+
+    {
+      unique_lock<mutex> lock(h->transferMutex);
+
+      // the output stubs are blocked in the pacer until the resume: they can't be removed
+      if(h->paused)
+        throw runtime_error("Can't remove a source while paused: resume first");
+
+      src = findSource(h, sourceId);
+      detachSource(h, src);
+    }
+
+    removeSourceModules(h, src);
+
+    unique_lock<mutex> lock(h->transferMutex);
+
+    for(auto i = h->sources.begin(); i != h->sources.end(); ++i)
+    {
+      if(i->get() == src)
+      {
+        h->sources.erase(i);
+        break;
+      }
+    }
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_switch(lldplay_handle* h, const char* url)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(!url)
+      throw runtime_error("URL can't be NULL");
+
+    unique_lock<mutex> control(h->controlMutex);
+
+    if(h->stopRequested)
+      throw runtime_error("The handle was stopped");
+
+    if(!h->pipe)
+      throw runtime_error("Not playing: use lldplay_play");
+
+    vector<shared_ptr<lldplay_handle::Source>> previous;
+
+    {
+      unique_lock<mutex> lock(h->transferMutex);
+
+      // the output stubs are blocked in the pacer, and the download scheduler
+      // wouldn't grant the new manifest request until the resume
+      if(h->paused)
+        throw runtime_error("Can't switch while paused: resume first");
+
+      previous = h->sources;
+
+      for(auto& src : previous)
+        detachSource(h, src.get());
+    }
+
+    // the pipeline, its threads and the HTTP connections are kept
+    for(auto& src : previous)
+      removeSourceModules(h, src.get());
+
+    {
+      unique_lock<mutex> lock(h->transferMutex);
+      h->sources.clear();
+      h->streams.clear();
+      h->streamRefs.clear();
+
+      for(auto& consumer : h->consumers)
+        consumer.cursors.clear();
+
+      h->jitterBuffer.reset();
+    }
+
+    h->pacer.reset();
+    h->scheduler.clearPriorities();
+
+    runWithThreadPolicy(h, [&]() { addSourceUnsafe(h, url); });
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_get_source_streams(lldplay_handle* h, int sourceId, int* firstStreamIndex, int* streamCount)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    unique_lock<mutex> lock(h->transferMutex);
+    auto src = findSource(h, sourceId);
+
+    if(firstStreamIndex)
+      *firstStreamIndex = src->firstStreamIndex;
+
+    if(streamCount)
+      *streamCount = src->streamCount;
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+// Marks a tile as enabled/disabled, and returns its adaptation control (if any).
+// Must be called with 'controlMutex' locked.
+static IAdaptationControl* setTileEnabled(lldplay_handle* h, int tileNumber, bool enabled, int quality, int& sourceOutput)
+{
+  unique_lock<mutex> lock(h->transferMutex);
+
+  if(tileNumber < 0 || tileNumber >= (int)h->streams.size())
+    throw runtime_error("Invalid tile number");
+
+  auto& stream = h->streams[tileNumber];
+
+  if(!stream.source)
+    return nullptr;
+
+  // only the adaptive sources switch
+  if(stream.source->adaptationControl && *stream.subscribed && enabled && (!stream.enabled || quality != stream.quality))
+  {
+    stream.switchPending = true;
+    stream.switchNeedsNewMetadata = stream.enabled;
+    stream.switchRequest = chrono::steady_clock::now();
+
+    // a tile being enabled starts at a segment boundary anyway
+    if(stream.enabled)
+      h->scheduler.requestSwitch(tileNumber, quality);
+  }
+
+  if(!enabled)
+  {
+    stream.switchPending = false;
+    h->scheduler.cancelSwitch(tileNumber);
+  }
+
+  stream.enabled = enabled;
+
+  if(enabled)
+    stream.quality = quality;
+
+  sourceOutput = stream.sourceOutput;
+
+  // applied when subscribing again
+  if(!*stream.subscribed)
+    return nullptr;
+
+  return stream.source->adaptationControl;
+}
+
+bool lldplay_enable_stream(lldplay_handle* h, int tileNumber, int quality)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    unique_lock<mutex> control(h->controlMutex);
+    int as = 0;
+
+    if(auto adaptationControl = setTileEnabled(h, tileNumber, true, quality, as))
+    {
+      adaptationControl->enableStream(as, quality);
+
+      if(isTracing())
+        traceInstant("control", "enable", tileNumber, format("quality %s", quality).c_str());
+    }
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_disable_stream(lldplay_handle* h, int tileNumber)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    unique_lock<mutex> control(h->controlMutex);
+    int as = 0;
+
+    if(auto adaptationControl = setTileEnabled(h, tileNumber, false, 0, as))
+    {
+      adaptationControl->disableStream(as);
+      traceInstant("control", "disable", tileNumber);
+    }
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught:failure %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_subscribe(lldplay_handle* h, int streamIndex, bool subscribe)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    unique_lock<mutex> control(h->controlMutex);
+    IAdaptationControl* adaptationControl = nullptr;
+    int as = 0;
+    bool enabled = false;
+    int quality = 0;
+
+    {
+      unique_lock<mutex> lock(h->transferMutex);
+      auto const tile = get_stream_index(h, streamIndex);
+      auto& stream = h->streams[tile];
+
+      if(*stream.subscribed == subscribe)
+        return true;
+
+      *stream.subscribed = subscribe;
+
+      if(!subscribe)
+      {
+        stream.switchPending = false;
+        h->scheduler.cancelSwitch(tile);
+
+        while(!stream.fifo.empty())
+          stream.fifo.pop();
+      }
+
+      if(stream.source)
+        adaptationControl = stream.source->adaptationControl;
+
+      as = stream.sourceOutput;
+      enabled = stream.enabled;
+      quality = stream.quality;
+    }
+
+    // DASH: the unsubscribed tiles aren't downloaded at all
+    if(adaptationControl && enabled)
+    {
+      if(subscribe)
+        adaptationControl->enableStream(as, quality);
+      else
+        adaptationControl->disableStream(as);
+    }
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_fast_switch(lldplay_handle* h, bool enabled)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    h->scheduler.setFastSwitch(enabled);
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_stream_priority(lldplay_handle* h, int tileNumber, int priority)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    {
+      unique_lock<mutex> lock(h->transferMutex);
+
+      if(tileNumber < 0 || tileNumber >= (int)h->streams.size())
+        throw runtime_error("Invalid tile number");
+    }
+
+    h->scheduler.setPriority(tileNumber, priority);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_frame_format(lldplay_handle* h, int tileNumber, int frameFormat)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(frameFormat < LLDPLAY_FRAME_FORMAT_AS_IS || frameFormat > LLDPLAY_FRAME_FORMAT_ANNEXB_WITH_PARAMS)
+      throw runtime_error("Invalid frame format");
+
+    unique_lock<mutex> lock(h->transferMutex);
+
+    if(tileNumber < 0 || tileNumber >= (int)h->streams.size())
+      throw runtime_error("Invalid tile number");
+
+    h->streams[tileNumber].frameFormat = frameFormat;
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_export_stream(lldplay_handle* h, int tileNumber, const char* name, int slotCount, int slotSize)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    unique_lock<mutex> lock(h->transferMutex);
+
+    if(tileNumber < 0 || tileNumber >= (int)h->streams.size())
+      throw runtime_error("Invalid tile number");
+
+    auto& stream = h->streams[tileNumber];
+
+    if(stream.exporter && stream.exporter->getDropped())
+      h->logger.log(Level::Warning, format("[%s] tile %s: %s frame(s) too large for the shared memory slots were dropped\n", __func__, tileNumber, stream.exporter->getDropped()).c_str());
+
+    stream.exporter.reset();
+
+    if(name)
+    {
+      stream.exporter = make_unique<ShmRingWriter>(name, slotCount, slotSize, stream.fourcc.c_str());
+
+      while(!stream.fifo.empty())
+        stream.fifo.pop();
+    }
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+struct lldplay_shm_reader
+{
+  lldplay_shm_reader(const char* name) : ring(name) {}
+  ShmRingReader ring;
+};
+
+lldplay_shm_reader* lldplay_shm_open(const char* name)
+{
+  try
+  {
+    if(!name)
+      return nullptr;
+
+    return new lldplay_shm_reader(name);
+  }
+  catch(exception const&)
+  {
+    return nullptr;
+  }
+}
+
+size_t lldplay_shm_read(lldplay_shm_reader* r, uint8_t* dst, size_t dstLen, FrameInfo* info, int timeoutMs)
+{
+  try
+  {
+    if(!r)
+      return 0;
+
+    return r->ring.read(dst, dstLen, info, timeoutMs);
+  }
+  catch(exception const&)
+  {
+    return 0;
+  }
+}
+
+uint64_t lldplay_shm_get_lost(lldplay_shm_reader* r)
+{
+  return r ? r->ring.getLost() : 0;
+}
+
+void lldplay_shm_close(lldplay_shm_reader* r)
+{
+  delete r;
+}
+
+// Results of 'lldplay_probe', by URL. Shared by all the handles.
+// Past 'MaxProbeCacheEntries', the least recently used entries are evicted.
+struct ProbeCacheEntry
+{
+  vector<StreamDesc> streams;
+  chrono::steady_clock::time_point time;
+  chrono::steady_clock::duration latency;
+  chrono::steady_clock::time_point lastUse;
+};
+
+static mutex g_probeCacheMutex;
+static map<string, ProbeCacheEntry> g_probeCache;
+
+// Must be called with 'g_probeCacheMutex' locked.
+static void evictProbeCacheEntries()
+{
+  while(g_probeCache.size() > MaxProbeCacheEntries)
+  {
+    auto oldest = g_probeCache.begin();
+
+    for(auto i = g_probeCache.begin(); i != g_probeCache.end(); ++i)
+      if(i->second.lastUse < oldest->second.lastUse)
+        oldest = i;
+
+    g_probeCache.erase(oldest);
+  }
+}
+
+static vector<StreamDesc> probeUrl(string const& url)
+{
+  vector<ProbedStream> probed;
+
+  if(isLibavUrl(url))
+    throw runtime_error("Can't probe a contribution feed without playing it");
+
+  if(isNetworkUrl(url))
+  {
+    string mpd;
+    createHttpSource()->wget(url.c_str(), [&] (SpanC data) { mpd.append((const char*)data.ptr, data.len); });
+
+    if(mpd.empty())
+      throw runtime_error("Can't download '" + url + "'");
+
+    probed = probeMpd(mpd.data(), mpd.size());
+  }
+  else if(url.size() >= 4 && url.compare(url.size() - 4, 4, ".mpd") == 0)
+  {
+    auto file = mapFile(url.c_str());
+    probed = probeMpd((const char*)file->data(), file->size());
+  }
+  else
+    probed = probeMp4(url.c_str());
+
+  vector<StreamDesc> r;
+
+  for(auto& stream : probed)
+  {
+    StreamDesc desc {};
+    memcpy(&desc.MP4_4CC, stream.fourcc.c_str(), min<size_t>(stream.fourcc.size(), 4));
+
+    if(!parseSrd(stream.srd, &desc))
+      throw runtime_error("Invalid SRD format: \"" + stream.srd + "\"");
+
+    r.push_back(desc);
+  }
+
+  return r;
+}
+
+bool lldplay_probe(const char* url, LLDashPlayoutProbeCallback callback, void* userData, int maxAgeMs)
+{
+  try
+  {
+    if(!url)
+      throw runtime_error("URL can't be NULL");
+
+    if(!callback)
+      throw runtime_error("callback can't be NULL");
+
+    auto const start = chrono::steady_clock::now();
+    ProbeCacheEntry entry;
+    bool cached = false;
+
+    {
+      unique_lock<mutex> lock(g_probeCacheMutex);
+      auto i = g_probeCache.find(url);
+
+      if(i != g_probeCache.end() && start - i->second.time < chrono::milliseconds(maxAgeMs))
+      {
+        i->second.lastUse = start;
+        entry = i->second;
+        cached = true;
+      }
+    }
+
+    if(!cached)
+    {
+      entry.streams = probeUrl(url);
+      entry.time = chrono::steady_clock::now();
+      entry.latency = entry.time - start;
+      entry.lastUse = entry.time;
+
+      unique_lock<mutex> lock(g_probeCacheMutex);
+      g_probeCache[url] = entry;
+      evictProbeCacheEntries();
+    }
+
+    ProbeInfo info {};
+    info.latencyUs = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    info.probeLatencyUs = chrono::duration_cast<chrono::microseconds>(entry.latency).count();
+    info.cached = cached;
+
+    callback(userData, entry.streams.data(), (int)entry.streams.size(), &info);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    fprintf(stderr, "[%s] exception caught: %s\n", __func__, err.what());
+    fflush(stderr);
+    return false;
+  }
+}
+
+bool lldplay_set_libav_profile(lldplay_handle* h, int profile, const char* options)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(profile != LLDPLAY_LIBAV_DEFAULT && profile != LLDPLAY_LIBAV_LOW_LATENCY)
+      throw runtime_error("Invalid profile");
+
+    unique_lock<mutex> lock(h->controlMutex);
+    h->libavProfile = profile;
+    h->libavOptions = options ? options : "";
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_max_downloads(lldplay_handle* h, int maxDownloads)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(maxDownloads < 0)
+      throw runtime_error("The number of downloads can't be negative");
+
+    h->scheduler.setMaxInFlight(maxDownloads);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+int lldplay_get_download_timings(lldplay_handle* h, struct DownloadTiming* timings, int maxCount)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(!timings || maxCount < 0)
+      throw runtime_error("timings can't be NULL");
+
+    auto toUs = [] (chrono::steady_clock::duration d)
+      {
+        return (int64_t)chrono::duration_cast<chrono::microseconds>(d).count();
+      };
+
+    auto records = h->scheduler.takeRecords(maxCount);
+
+    for(int i = 0; i < (int)records.size(); ++i)
+    {
+      auto& r = records[i];
+      auto& t = timings[i];
+      t = {};
+      t.tileNumber = r.tile;
+      t.ok = r.ok;
+      t.queueingTimeUs = toUs(r.queueing);
+      t.transferTimeUs = toUs(r.transfer);
+      t.bytes = r.bytes;
+      snprintf(t.url, sizeof t.url, "%s", r.url.c_str());
+    }
+
+    return (int)records.size();
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return 0;
+  }
+}
+
+bool lldplay_seek(lldplay_handle* h, int64_t timestampMs)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    // not while a source is being removed: its demuxer may already be gone
+    unique_lock<mutex> control(h->controlMutex);
+    unique_lock<mutex> lock(h->transferMutex);
+    bool seekable = false;
+
+    for(auto& src : h->sources)
+    {
+      if(!src->removed && src->seekControl)
+      {
+        src->seekControl->seek(timestampMs);
+        seekable = true;
+      }
+    }
+
+    if(!seekable)
+      throw runtime_error("Seeking is only supported when playing a local file");
+
+    // drop the frames demuxed before the seek
+
+    for(auto& s : h->streams)
+      while(!s.fifo.empty())
+        s.fifo.pop();
+
+    h->pacer.reset();
+    h->jitterBuffer.reset();
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_pause(lldplay_handle* h)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(!h->pipe)
+      throw runtime_error("Can only pause when the pipeline is playing");
+
+    unique_lock<mutex> control(h->controlMutex);
+
+    {
+      unique_lock<mutex> lock(h->transferMutex);
+
+      if(h->paused)
+        return true;
+
+      h->paused = true;
+
+      for(auto& s : h->streams)
+      {
+        s.resumePending = false;
+
+        while(!s.fifo.empty())
+          s.fifo.pop();
+      }
+    }
+
+    // the demuxers block on their next request, or on their next frame
+    h->scheduler.setPaused(true);
+
+    for(auto& src : h->sources)
+      h->pacer.hold(src->pacingAnchor);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_resume(lldplay_handle* h, int mode)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(mode != LLDPLAY_RESUME_CONTINUE && mode != LLDPLAY_RESUME_LIVE_EDGE)
+      throw runtime_error(format("Unknown resume mode %s", mode));
+
+    vector<shared_ptr<lldplay_handle::Source>> rejoining;
+
+    {
+      unique_lock<mutex> control(h->controlMutex);
+
+      {
+        unique_lock<mutex> lock(h->transferMutex);
+
+        if(!h->paused)
+          return true;
+
+        h->paused = false;
+        h->resumed = chrono::steady_clock::now();
+        h->jitterBuffer.reset();
+
+        for(auto& s : h->streams)
+          s.resumePending = s.enabled && *s.subscribed;
+
+        for(auto& src : h->sources)
+        {
+          // the pause isn't an outage
+          src->lastFrame = h->resumed;
+
+          if(mode == LLDPLAY_RESUME_LIVE_EDGE && src->isNetwork && !src->removed)
+            rejoining.push_back(src);
+        }
+      }
+
+      // the network sources rejoin the live edge: their held frames are obsolete
+      for(auto& src : h->sources)
+        h->pacer.release(src->pacingAnchor, mode == LLDPLAY_RESUME_LIVE_EDGE && src->isNetwork);
+
+      h->scheduler.setPaused(false);
+    }
+
+    // new demuxers, starting at the live edge
+    for(auto& src : rejoining)
+      reconnectSource(h, src.get());
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_pacing(lldplay_handle* h, double speed, int lookaheadMs)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(speed < 0 || lookaheadMs < 0)
+      throw runtime_error("speed and lookahead can't be negative");
+
+    unique_lock<mutex> control(h->controlMutex);
+    h->pacingConfigured = true;
+    h->pacingSpeed = speed;
+    h->pacingLookaheadMs = lookaheadMs;
+
+    for(auto& src : h->sources)
+      h->pacer.configure(src->pacingAnchor, speed, lookaheadMs);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_source_pacing(lldplay_handle* h, int sourceId, double speed, int lookaheadMs)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(speed < 0 || lookaheadMs < 0)
+      throw runtime_error("speed and lookahead can't be negative");
+
+    unique_lock<mutex> control(h->controlMutex);
+    h->pacer.configure(findSource(h, sourceId)->pacingAnchor, speed, lookaheadMs);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_jitter_buffer(lldplay_handle* h, int minDelayMs, int maxDelayMs)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(minDelayMs < 0 || maxDelayMs < minDelayMs)
+      throw runtime_error("The delays must verify 0 <= minDelayMs <= maxDelayMs");
+
+    unique_lock<mutex> lock(h->transferMutex);
+    h->jitterBuffer.configure(minDelayMs, maxDelayMs);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_get_playout_clock(lldplay_handle* h, struct PlayoutClock* clock)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(!clock)
+      throw runtime_error("clock can't be NULL");
+
+    unique_lock<mutex> lock(h->transferMutex);
+    auto const& jb = h->jitterBuffer;
+
+    if(!jb.enabled())
+      throw runtime_error("The jitter buffer is disabled");
+
+    if(!jb.anchored)
+      return false;
+
+    auto toUs = [] (chrono::steady_clock::time_point t)
+      {
+        return (int64_t)chrono::duration_cast<chrono::microseconds>(t.time_since_epoch()).count();
       };
 
-    if(startsWith(url, "http://") || startsWith(url, "https://"))
-    {
-      DashDemuxConfig cfg;
-      cfg.url = url;
-      cfg.adaptationControlCbk = bind(&lldplay_handle::adaptationControlCbk, h, placeholders::_1);
-      auto demux = pipe.add("DashDemuxer", &cfg);
+    *clock = {};
+    clock->mediaTimeMs = jb.lastPts / (IClock::Rate / 1000LL);
+    clock->localTimeUs = toUs(jb.lastDue);
+    clock->nowUs = toUs(chrono::steady_clock::now());
+    clock->delayMs = (int)chrono::duration_cast<chrono::milliseconds>(jb.lastDelay).count();
+    clock->jitterMs = (float)(jb.lastJitterUs / 1000);
+    clock->lateFrames = jb.lateFrames;
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+static void getFrameInfo(Data const& s, FrameInfo* info)
+{
+  *info = {};
+  info->timestamp = s->get<PresentationTime>().time / (IClock::Rate / 1000LL);
+
+  auto meta = dynamic_pointer_cast<const MetadataPkt>(s->getMetadata());
+
+  if(meta)
+  {
+    auto const& dsi = meta->codecSpecificInfo;
+
+    if(dsi.size() > sizeof(info->dsi))
+      throw runtime_error("DSI buffer too small");
+
+    memcpy(info->dsi, dsi.data(), dsi.size());
+    info->dsi_size = dsi.size();
+  }
+}
+
+// Refreshed when the DSI changes (e.g on quality switches)
+static NalConfig const& getNalConfig(lldplay_handle::Stream& stream, Data const& s)
+{
+  auto meta = dynamic_pointer_cast<const MetadataPkt>(s->getMetadata());
+
+  if(meta && meta->codecSpecificInfo != stream.nalConfigDsi)
+  {
+    // not cached if invalid: every frame using it fails
+    stream.nalConfig = parseNalConfig(stream.fourcc, meta->codecSpecificInfo.data(), meta->codecSpecificInfo.size());
+    stream.nalConfigDsi = meta->codecSpecificInfo;
+  }
+
+  return stream.nalConfig;
+}
+
+static bool needsParameterSets(lldplay_handle::Stream const& stream, Data const& s)
+{
+  return stream.frameFormat == LLDPLAY_FRAME_FORMAT_ANNEXB_WITH_PARAMS && s->get<CueFlags>().keyframe;
+}
+
+// Size of the frame, once in the output format of the stream
+static size_t getOutputSize(lldplay_handle::Stream& stream, Data const& s)
+{
+  auto const payload = s->data();
+
+  if(stream.frameFormat == LLDPLAY_FRAME_FORMAT_AS_IS)
+    return payload.len;
+
+  auto const& nal = getNalConfig(stream, s);
+
+  if(!nal.lengthSize)
+    return payload.len;
+
+  auto const prefix = needsParameterSets(stream, s) ? nal.parameterSets.size() : 0;
+  return prefix + getAnnexBSize(payload.ptr, payload.len, nal.lengthSize);
+}
+
+// Copies the frame in the output format of the stream. 'dst' must hold 'getOutputSize' bytes.
+// Doesn't throw once 'getOutputSize' succeeded.
+static void copyFrame(lldplay_handle::Stream& stream, uint8_t* dst, Data const& s)
+{
+  auto const payload = s->data();
+
+  if(stream.frameFormat == LLDPLAY_FRAME_FORMAT_AS_IS)
+  {
+    memcpy(dst, payload.ptr, payload.len);
+    return;
+  }
+
+  auto const& nal = getNalConfig(stream, s);
+
+  if(!nal.lengthSize)
+  {
+    memcpy(dst, payload.ptr, payload.len);
+    return;
+  }
+
+  if(needsParameterSets(stream, s))
+  {
+    memcpy(dst, nal.parameterSets.data(), nal.parameterSets.size());
+    dst += nal.parameterSets.size();
+  }
+
+  copyToAnnexB(dst, payload.ptr, payload.len, nal.lengthSize);
+}
+
+// Must be called with 'transferMutex' locked.
+static void exportFrame(lldplay_handle::Stream& stream, Data const& data)
+{
+  // everything which can throw is done before the write begins
+  auto const size = getOutputSize(stream, data);
+  FrameInfo info;
+  getFrameInfo(data, &info);
+
+  if(auto dst = stream.exporter->beginWrite(size))
+  {
+    copyFrame(stream, dst, data);
+    stream.exporter->endWrite(size, info);
+  }
+}
+
+// The next frame for a cursor, or null. Skips the frames flushed meanwhile.
+// The frames held by the jitter buffer aren't available yet.
+// Must be called with 'transferMutex' locked.
+static lldplay_handle::Stream::Frame* peekFrame(lldplay_handle::Stream& stream, uint64_t& cursor)
+{
+  cursor = max(cursor, stream.fifo.frontSeq());
+  auto const index = cursor - stream.fifo.frontSeq();
+
+  if(index >= stream.fifo.size())
+    return nullptr;
+
+  auto& frame = stream.fifo.at(index);
+
+  if(frame.due > chrono::steady_clock::now())
+    return nullptr;
+
+  return &frame;
+}
+
+// Pops the frames read by all the consumers.
+// Must be called with 'transferMutex' locked.
+static void releaseFrames(lldplay_handle* h, int tile)
+{
+  auto& stream = h->streams[tile];
+  auto oldest = stream.fifo.frontSeq() + stream.fifo.size();
+
+  if(h->defaultConsumer)
+    oldest = min(oldest, stream.cursor);
+
+  for(auto& consumer : h->consumers)
+    oldest = min(oldest, consumer.at(tile).next);
+
+  while(stream.fifo.frontSeq() < oldest)
+    stream.fifo.pop();
+}
+
+// Size of the next frame of a cursor, once in the output format of the stream.
+// A frame which can't be converted (e.g truncated NAL units) is dropped: it would block the cursor.
+// Must be called with 'transferMutex' locked.
+static size_t getOutputSizeOrDrop(lldplay_handle* h, int tile, uint64_t& cursor, Data const& s)
+{
+  try
+  {
+    return getOutputSize(h->streams[tile], s);
+  }
+  catch(exception const&)
+  {
+    ++cursor;
+    releaseFrames(h, tile);
+    throw;
+  }
+}
+
+// Moves the consumers lagging too much to their oldest allowed frame, so they can't pin the frames.
+// Must be called with 'transferMutex' locked.
+static void enforceMaxLags(lldplay_handle* h, int tile)
+{
+  auto& stream = h->streams[tile];
+  auto const end = stream.fifo.frontSeq() + stream.fifo.size();
+
+  for(auto& consumer : h->consumers)
+  {
+    auto& cursor = consumer.at(tile);
+    cursor.next = max(cursor.next, stream.fifo.frontSeq());
 
-      for(int k = 0; k < demux->getNumOutputs(); ++k)
-        addStream(GetOutputPin(demux, k));
+    if(end - cursor.next > consumer.maxLag)
+    {
+      cursor.framesDropped += end - consumer.maxLag - cursor.next;
+      cursor.next = end - consumer.maxLag;
     }
-    else if(startsWith(url, "rtmp://"))
+  }
+
+  releaseFrames(h, tile);
+}
+
+// Copies the next frame of a cursor into 'dst' (when not null), and returns its size.
+// Must be called with 'transferMutex' locked.
+static size_t grabFrame(lldplay_handle* h, int tile, uint64_t& cursor, uint8_t* dst, size_t dstLen, FrameInfo* info, chrono::steady_clock::time_point start)
+{
+  auto& stream = h->streams[tile];
+  auto frame = peekFrame(stream, cursor);
+
+  if(!frame)
+    return 0;
+
+  auto s = frame->data;
+  auto const N = getOutputSizeOrDrop(h, tile, cursor, s);
+
+  if(!dst)
+    return N;
+
+  auto const arrival = frame->arrival;
+  auto const id = frame->id;
+  ++cursor;
+  releaseFrames(h, tile);
+
+  if(N > dstLen)
+    throw runtime_error("Buffer too small");
+
+  copyFrame(stream, dst, s);
+
+  if(info)
+    getFrameInfo(s, info);
+
+  if(isTracing())
+  {
+    auto const now = chrono::steady_clock::now();
+    traceAsyncSpan("delivery", "queued", id, arrival, now, tile);
+    traceSpan("delivery", "grab", start, now, tile);
+  }
+
+  return N;
+}
+
+size_t lldplay_grab_frame(lldplay_handle* h, int i, uint8_t* dst, size_t dstLen, FrameInfo* info)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    auto const start = chrono::steady_clock::now();
+    unique_lock<mutex> lock(h->transferMutex);
+
+    if(!h->defaultConsumer)
+      throw runtime_error("The default consumer was removed: use lldplay_consumer_grab_frame");
+
+    auto const tile = get_stream_index(h, i);
+    return grabFrame(h, tile, h->streams[tile].cursor, dst, dstLen, info, start);
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return 0;
+  }
+}
+
+static lldplay_handle::Consumer& findConsumer(lldplay_handle* h, int consumerId)
+{
+  for(auto& consumer : h->consumers)
+    if(consumer.id == consumerId)
+      return consumer;
+
+  throw runtime_error("Unknown consumer");
+}
+
+int lldplay_add_consumer(lldplay_handle* h, int maxLag)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(maxLag <= 0)
+      throw runtime_error("maxLag must be positive");
+
+    unique_lock<mutex> lock(h->transferMutex);
+
+    lldplay_handle::Consumer consumer;
+    consumer.id = h->nextConsumerId++;
+    consumer.maxLag = maxLag;
+
+    // starts with the next frames
+    for(int tile = 0; tile < (int)h->streams.size(); ++tile)
     {
-      DemuxConfig cfg;
-      cfg.url = url;
-      auto demux = pipe.add("LibavDemux", &cfg);
+      auto const& fifo = h->streams[tile].fifo;
+      consumer.at(tile).next = fifo.frontSeq() + fifo.size();
+    }
+
+    h->consumers.push_back(move(consumer));
+
+    return h->consumers.back().id;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return -1;
+  }
+}
+
+bool lldplay_remove_consumer(lldplay_handle* h, int consumerId)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    unique_lock<mutex> lock(h->transferMutex);
 
-      for(int k = 0; k < demux->getNumOutputs(); ++k)
-        addStream(GetOutputPin(demux, k));
+    if(consumerId == 0)
+    {
+      h->defaultConsumer = false;
     }
     else
     {
-      Mp4DemuxConfig cfg;
-      cfg.path = url;
-      auto demux = pipe.add("GPACDemuxMP4Simple", &cfg);
-
-      for(int k = 0; k < demux->getNumOutputs(); ++k)
-        addStream(GetOutputPin(demux, k));
+      auto& consumer = findConsumer(h, consumerId);
+      h->consumers.erase(h->consumers.begin() + (&consumer - h->consumers.data()));
     }
 
-    pipe.start();
+    for(int tile = 0; tile < (int)h->streams.size(); ++tile)
+      releaseFrames(h, tile);
 
     return true;
   }
@@ -363,93 +2733,190 @@ bool lldplay_play(lldplay_handle* h, const char* url)
   }
 }
 
-bool lldplay_enable_stream(lldplay_handle* h, int tileNumber, int quality)
+size_t lldplay_consumer_grab_frame(lldplay_handle* h, int consumerId, int streamIndex, uint8_t* dst, size_t dstLen, FrameInfo* info)
 {
   try
   {
     if(!h)
       throw runtime_error("handle can't be NULL");
 
-    h->adaptationControl->enableStream(tileNumber, quality);
+    auto const start = chrono::steady_clock::now();
+    unique_lock<mutex> lock(h->transferMutex);
+
+    auto const tile = get_stream_index(h, streamIndex);
+    auto& cursor = findConsumer(h, consumerId).at(tile);
+    auto const N = grabFrame(h, tile, cursor.next, dst, dstLen, info, start);
 
-    return true;
+    if(N && dst)
+      ++cursor.framesRead;
+
+    return N;
   }
   catch(exception const& err)
   {
     h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
-    return false;
+    return 0;
   }
 }
 
-bool lldplay_disable_stream(lldplay_handle* h, int tileNumber)
+bool lldplay_get_consumer_stats(lldplay_handle* h, int consumerId, int streamIndex, struct ConsumerStats* stats)
 {
   try
   {
     if(!h)
       throw runtime_error("handle can't be NULL");
 
-    h->adaptationControl->disableStream(tileNumber);
+    if(!stats)
+      throw runtime_error("stats can't be NULL");
+
+    unique_lock<mutex> lock(h->transferMutex);
+
+    auto const tile = get_stream_index(h, streamIndex);
+    auto const& fifo = h->streams[tile].fifo;
+    auto& cursor = findConsumer(h, consumerId).at(tile);
+    auto const end = fifo.frontSeq() + fifo.size();
+
+    *stats = {};
+    stats->framesRead = cursor.framesRead;
+    stats->framesDropped = cursor.framesDropped;
+    stats->lag = (uint32_t)(end - max(cursor.next, fifo.frontSeq()));
 
     return true;
   }
   catch(exception const& err)
   {
-    h->logger.log(Level::Error, format("[%s] exception caught:failure %s\n", __func__, err.what()).c_str());
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
     return false;
   }
 }
 
-size_t lldplay_grab_frame(lldplay_handle* h, int i, uint8_t* dst, size_t dstLen, FrameInfo* info)
+// The streams making up the frame sets: the timestamp of a set, its entries and its sizes only come from these.
+static bool isInFrameSet(lldplay_handle::Stream const& stream)
+{
+  return stream.enabled && !stream.exporter && *stream.subscribed;
+}
+
+int lldplay_grab_frameset(lldplay_handle* h, uint8_t* dst, size_t dstLen, FrameSetEntry* entries, int maxEntries, int64_t* timestamp)
 {
   try
   {
     if(!h)
       throw runtime_error("handle can't be NULL");
 
+    if(!entries)
+      throw runtime_error("entries can't be NULL");
+
     unique_lock<mutex> lock(h->transferMutex);
 
-    if(i < 0 || i >= lldplay_get_stream_count(h))
-      throw runtime_error("Invalid stream index");
+    if(!h->defaultConsumer)
+      throw runtime_error("The default consumer was removed");
+
+    // the set is built on the earliest presentation time available
+    bool found = false;
+    int64_t pts = 0;
+
+    for(auto& stream : h->streams)
+    {
+      if(!isInFrameSet(stream))
+        continue;
+
+      auto const frame = peekFrame(stream, stream.cursor);
+
+      if(!frame)
+        continue;
+
+      auto const t = frame->data->get<PresentationTime>().time;
 
-    auto const streamIndex = get_stream_index(h, i);
-    auto& stream = h->streams[streamIndex];
+      if(!found || t < pts)
+        pts = t;
 
-    if(stream.fifo.empty())
+      found = true;
+    }
+
+    if(!found)
       return 0;
 
-    auto s = stream.fifo.front();
-    auto const N = s->data().len;
+    // A tile whose next frame comes later has lost its frame for this set.
+    // An empty tile might still receive it: wait for it until the deadline.
+    int count = 0;
+    bool waitingForLateTiles = false;
+    auto firstArrival = chrono::steady_clock::time_point::max();
+    size_t totalSize = 0;
 
-    if(!dst)
-      return N;
+    for(int tile = 0; tile < (int)h->streams.size(); ++tile)
+    {
+      auto& stream = h->streams[tile];
 
-    stream.fifo.pop();
+      if(!isInFrameSet(stream))
+        continue;
 
-    if(N > dstLen)
+      ++count;
+
+      auto const frame = peekFrame(stream, stream.cursor);
+
+      if(!frame)
+      {
+        waitingForLateTiles = true;
+        continue;
+      }
+
+      if(frame->data->get<PresentationTime>().time == pts)
+      {
+        firstArrival = min(firstArrival, frame->arrival);
+        totalSize += getOutputSizeOrDrop(h, tile, stream.cursor, frame->data);
+      }
+    }
+
+    if(waitingForLateTiles && chrono::steady_clock::now() < firstArrival + h->frameSetDeadline)
+      return 0;
+
+    if(count > maxEntries)
+      throw runtime_error("Too many tiles for the entries array");
+
+    if(dst && totalSize > dstLen)
       throw runtime_error("Buffer too small");
 
-    memcpy(dst, s->data().ptr, N);
+    int i = 0;
+    size_t offset = 0;
 
-    if(info)
+    for(int tile = 0; tile < (int)h->streams.size(); ++tile)
     {
-      *info = {};
-      info->timestamp = s->get<PresentationTime>().time / (IClock::Rate / 1000LL);
+      auto& stream = h->streams[tile];
 
-      auto meta = dynamic_pointer_cast<const MetadataPkt>(s->getMetadata());
+      if(!isInFrameSet(stream))
+        continue;
 
-      if(meta)
-      {
-        auto dsi = meta->codecSpecificInfo;
+      auto& entry = entries[i++];
+      entry = {};
+      entry.tileNumber = tile;
+      entry.missing = 1;
 
-        if(dsi.size() > sizeof(info->dsi))
-          throw runtime_error("DSI buffer too small");
+      auto const frame = peekFrame(stream, stream.cursor);
 
-        memcpy(info->dsi, dsi.data(), dsi.size());
-        info->dsi_size = dsi.size();
-      }
+      if(!frame || frame->data->get<PresentationTime>().time != pts)
+        continue;
+
+      auto s = frame->data;
+      entry.missing = 0;
+      entry.offset = offset;
+      entry.size = getOutputSize(stream, s);
+      getFrameInfo(s, &entry.info);
+      offset += entry.size;
+
+      // 'dst' is null: only report the sizes
+      if(!dst)
+        continue;
+
+      copyFrame(stream, dst + entry.offset, s);
+      traceAsyncSpan("delivery", "queued", frame->id, frame->arrival, chrono::steady_clock::now(), tile);
+      ++stream.cursor;
+      releaseFrames(h, tile);
     }
 
-    return N;
+    if(timestamp)
+      *timestamp = pts / (IClock::Rate / 1000LL);
+
+    return count;
   }
   catch(exception const& err)
   {
@@ -458,6 +2925,123 @@ size_t lldplay_grab_frame(lldplay_handle* h, int i, uint8_t* dst, size_t dstLen,
   }
 }
 
+bool lldplay_set_frameset_deadline(lldplay_handle* h, int deadlineMs)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(deadlineMs < 0)
+      throw runtime_error("deadline can't be negative");
+
+    unique_lock<mutex> lock(h->transferMutex);
+    h->frameSetDeadline = chrono::milliseconds(deadlineMs);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_reconnect_policy(lldplay_handle* h, int stallTimeoutMs, int minBackoffMs, int maxBackoffMs)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(stallTimeoutMs < 0 || minBackoffMs <= 0 || maxBackoffMs < minBackoffMs)
+      throw runtime_error("Invalid reconnect policy: timeouts must be positive, and the backoff range not empty");
+
+    unique_lock<mutex> lock(h->transferMutex);
+    h->reconnect.stallTimeout = chrono::milliseconds(stallTimeoutMs);
+    h->reconnect.minBackoff = chrono::milliseconds(minBackoffMs);
+    h->reconnect.maxBackoff = chrono::milliseconds(maxBackoffMs);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_trace(lldplay_handle* h, const char* path)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(path)
+    {
+      if(!traceStart(path))
+        throw runtime_error("A trace is already running");
+
+      h->tracing = true;
+    }
+    else
+    {
+      if(!h->tracing)
+        throw runtime_error("No trace was started from this handle");
+
+      traceStop();
+      h->tracing = false;
+    }
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_record(lldplay_handle* h, const char* dir)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    h->scheduler.setCapture(dir ? make_shared<CaptureWriter>(dir) : nullptr);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
+bool lldplay_set_replay(lldplay_handle* h, const char* dir, double speed)
+{
+  try
+  {
+    if(!h)
+      throw runtime_error("handle can't be NULL");
+
+    if(speed < 0)
+      throw runtime_error("Invalid speed");
+
+    h->scheduler.setReplay(dir ? make_shared<CaptureReplay>(dir, speed) : nullptr);
+
+    return true;
+  }
+  catch(exception const& err)
+  {
+    h->logger.log(Level::Error, format("[%s] exception caught: %s\n", __func__, err.what()).c_str());
+    return false;
+  }
+}
+
 const char *lldplay_get_version() {
 #ifdef LLDASH_VERSION
 #define LLDASH_VERSION_STRINGIFY2(x) LLDASH_VERSION_STRINGIFY(x)
@@ -0,0 +1,260 @@
+#include "probe.h"
+#include "filemap.h"
+#include "mp4_index.h"
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+auto const SrdScheme = "urn:mpeg:dash:srd:2014";
+
+// One XML element tag, e.g '<Representation id="1" codecs="avc1.64001f"/>'
+struct Tag
+{
+  string name; // without namespace prefix
+  string text; // from the name to the closing '>'
+  bool closing = false; // '</name>'
+  bool empty = false; // '<name/>'
+};
+
+// Returns the value of an attribute, or an empty string.
+string getAttribute(Tag const& tag, const char* name)
+{
+  auto const len = strlen(name);
+  size_t pos = 0;
+
+  while((pos = tag.text.find(name, pos)) != string::npos)
+  {
+    auto const end = pos + len;
+
+    // whole attribute name: preceded by a space, followed by '='
+    if(pos > 0 && isspace((unsigned char)tag.text[pos - 1]) && end + 1 < tag.text.size() && tag.text[end] == '=')
+    {
+      auto const quote = tag.text[end + 1];
+
+      if(quote == '"' || quote == '\'')
+      {
+        auto const close = tag.text.find(quote, end + 2);
+
+        if(close != string::npos)
+          return tag.text.substr(end + 2, close - end - 2);
+      }
+    }
+
+    pos = end;
+  }
+
+  return "";
+}
+
+// Iterates over the element tags, skipping the comments and the processing instructions.
+struct TagReader
+{
+  TagReader(const char* text, size_t size) : s(text, size) {}
+
+  bool next(Tag& tag)
+  {
+    while(true)
+    {
+      auto const open = s.find('<', pos);
+
+      if(open == string::npos)
+        return false;
+
+      if(s.compare(open, 4, "<!--") == 0)
+      {
+        pos = s.find("-->", open);
+
+        if(pos == string::npos)
+          return false;
+
+        continue;
+      }
+
+      auto const close = s.find('>', open);
+
+      if(close == string::npos)
+        return false;
+
+      pos = close + 1;
+
+      // processing instructions, declarations
+      if(s[open + 1] == '?' || s[open + 1] == '!')
+        continue;
+
+      tag = {};
+      tag.closing = s[open + 1] == '/';
+      tag.empty = s[close - 1] == '/';
+
+      auto const nameStart = open + (tag.closing ? 2 : 1);
+      auto nameEnd = nameStart;
+
+      while(nameEnd < close && !isspace((unsigned char)s[nameEnd]) && s[nameEnd] != '/')
+        ++nameEnd;
+
+      tag.name = s.substr(nameStart, nameEnd - nameStart);
+      tag.text = s.substr(nameStart, close - nameStart);
+
+      auto const colon = tag.name.find(':');
+
+      if(colon != string::npos)
+        tag.name = tag.name.substr(colon + 1);
+
+      return true;
+    }
+  }
+
+  string const s;
+  size_t pos = 0;
+};
+
+// e.g "avc1.64001f" -> "avc1"
+string getFourcc(string const& codecs)
+{
+  return codecs.substr(0, codecs.find('.'));
+}
+}
+
+vector<ProbedStream> probeMpd(const char* text, size_t size)
+{
+  vector<ProbedStream> r;
+
+  TagReader reader(text, size);
+  Tag tag;
+
+  bool inAdaptationSet = false;
+  int representationDepth = 0;
+  string setCodecs;
+  string setSrd;
+  vector<string> representationCodecs;
+
+  while(reader.next(tag))
+  {
+    if(tag.name == "Period" && tag.closing)
+      break; // first period only
+
+    if(tag.name == "AdaptationSet")
+    {
+      if(!tag.closing)
+      {
+        inAdaptationSet = !tag.empty;
+        setCodecs = getAttribute(tag, "codecs");
+        setSrd.clear();
+        representationCodecs.clear();
+        continue;
+      }
+
+      for(auto& codecs : representationCodecs)
+        r.push_back({ getFourcc(codecs.empty() ? setCodecs : codecs), setSrd });
+
+      inAdaptationSet = false;
+      continue;
+    }
+
+    if(!inAdaptationSet)
+      continue;
+
+    if(tag.name == "Representation")
+    {
+      if(!tag.closing)
+        representationCodecs.push_back(getAttribute(tag, "codecs"));
+
+      representationDepth += tag.closing ? -1 : (tag.empty ? 0 : 1);
+      continue;
+    }
+
+    // the SRD of the adaptation set, not of one of its representations
+    if(!representationDepth && !tag.closing && (tag.name == "SupplementalProperty" || tag.name == "EssentialProperty"))
+      if(getAttribute(tag, "schemeIdUri") == SrdScheme)
+        setSrd = getAttribute(tag, "value");
+  }
+
+  if(r.empty())
+    throw runtime_error("no representation found in the MPD");
+
+  return r;
+}
+
+vector<ProbedTemplate> probeMpdTemplates(const char* text, size_t size)
+{
+  vector<ProbedTemplate> r;
+
+  TagReader reader(text, size);
+  Tag tag;
+
+  bool inAdaptationSet = false;
+  int representationDepth = 0;
+  bool perRepresentation = false;
+
+  while(reader.next(tag))
+  {
+    if(tag.name == "Period" && tag.closing)
+      break; // first period only
+
+    if(tag.name == "AdaptationSet")
+    {
+      if(!tag.closing)
+      {
+        r.push_back({});
+        inAdaptationSet = !tag.empty;
+        perRepresentation = false;
+        continue;
+      }
+
+      // each representation has its own template: no shared one
+      if(perRepresentation)
+        r.back().media.clear();
+
+      inAdaptationSet = false;
+      continue;
+    }
+
+    if(!inAdaptationSet)
+      continue;
+
+    if(tag.name == "Representation")
+    {
+      if(!tag.closing)
+        r.back().representationIds.push_back(getAttribute(tag, "id"));
+
+      representationDepth += tag.closing ? -1 : (tag.empty ? 0 : 1);
+      continue;
+    }
+
+    if(tag.name == "SegmentTemplate" && !tag.closing)
+    {
+      if(representationDepth)
+      {
+        perRepresentation = true;
+        continue;
+      }
+
+      r.back().media = getAttribute(tag, "media");
+      r.back().initialization = getAttribute(tag, "initialization");
+    }
+  }
+
+  return r;
+}
+
+vector<ProbedStream> probeMp4(const char* path)
+{
+  auto file = mapFile(path);
+  vector<ProbedStream> r;
+
+  for(auto& t : parseMp4Index(file->data(), file->size()))
+  {
+    if(t.samples.empty())
+      continue;
+
+    r.push_back({ t.fourcc, "" });
+  }
+
+  if(r.empty())
+    throw runtime_error(string("no samples found in '") + path + "'");
+
+  return r;
+}
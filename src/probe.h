@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Stream topology of a source, read without playing it (see lldplay_probe).
+
+struct ProbedStream
+{
+  std::string fourcc;
+  std::string srd; // value of the SRD property, e.g "0,1,0,1,1,2,2". Empty if none.
+};
+
+// One entry per representation of each adaptation set of the first period, in document order.
+// Only the elements describing the streams are read: the document isn't validated.
+std::vector<ProbedStream> probeMpd(const char* text, size_t size);
+
+// Segment template of an adaptation set.
+struct ProbedTemplate
+{
+  std::string media; // shared by the representations, e.g "$RepresentationID$-$Number$.m4s". Empty if none.
+  std::string initialization;
+  std::vector<std::string> representationIds; // in document order
+};
+
+// One entry per adaptation set of the first period, in document order.
+std::vector<ProbedTemplate> probeMpdTemplates(const char* text, size_t size);
+
+// One entry per track having samples, as demuxed by Mp4MmapDemux.
+std::vector<ProbedStream> probeMp4(const char* path);
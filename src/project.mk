@@ -12,6 +12,19 @@ SUB_SRCS:=\
   $(LIB_PIPELINE_SRCS)\
   $(LIB_UTILS_SRCS)\
   $(MYDIR)/plugin.cpp\
+  $(MYDIR)/annexb.cpp\
+  $(MYDIR)/capture.cpp\
+  $(MYDIR)/download_scheduler.cpp\
+  $(MYDIR)/fast_switch.cpp\
+  $(MYDIR)/manifest_puller.cpp\
+  $(MYDIR)/tracer.cpp\
+  $(MYDIR)/mp4_index.cpp\
+  $(MYDIR)/mp4_mmap_demux.cpp\
+  $(MYDIR)/probe.cpp\
+  $(MYDIR)/shm_ring.cpp\
+  $(MYDIR)/filemap_$(HOST).cpp\
+  $(MYDIR)/shm_$(HOST).cpp\
+  $(MYDIR)/thread_policy_$(HOST).cpp\
 
 $(BIN)/signals-unity-bridge.so: $(SUB_SRCS:%=$(BIN)/%.o)
 TARGETS+=$(BIN)/signals-unity-bridge.so
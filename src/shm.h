@@ -0,0 +1,27 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Named shared memory, visible to the other processes of the machine.
+struct SharedMemory
+{
+  virtual ~SharedMemory() = default;
+  virtual uint8_t* data() const = 0;
+  virtual size_t size() const = 0;
+};
+
+// Creates (or replaces) a zero-filled region. The name is removed when the returned object is destroyed,
+// the processes having it opened keep their mapping.
+// On Windows, a name can't be replaced: this fails while a region of this name is opened.
+std::unique_ptr<SharedMemory> createSharedMemory(const char* name, size_t size);
+
+std::unique_ptr<SharedMemory> openSharedMemory(const char* name);
+
+// Cross-process wait on a 32-bit word of a shared region:
+// returns when '*word' differs from 'expected', when woken up, or after 'timeoutMs'.
+// Spurious returns are possible.
+void waitForChange(std::atomic<uint32_t>* word, uint32_t expected, int timeoutMs);
+void wakeWaiters(std::atomic<uint32_t>* word);
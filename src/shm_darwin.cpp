@@ -0,0 +1,101 @@
+// this file is macOS specific
+#include "shm.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+struct SharedMemoryDarwin : SharedMemory
+{
+  SharedMemoryDarwin(const char* name_, size_t size, bool create)
+    : name(name_), owner(create)
+  {
+    if(create)
+      shm_unlink(name_); // a new region: the readers of a previous one keep it, unchanged
+
+    auto fd = create ? shm_open(name_, O_RDWR | O_CREAT | O_EXCL, 0600) : shm_open(name_, O_RDWR, 0);
+
+    if(fd < 0)
+      throw runtime_error(string("can't open the shared memory '") + name_ + "' (" + strerror(errno) + ")");
+
+    if(create && ftruncate(fd, (off_t)size) != 0)
+    {
+      close(fd);
+      shm_unlink(name_);
+      throw runtime_error(string("can't size the shared memory '") + name_ + "' (" + strerror(errno) + ")");
+    }
+
+    if(!create)
+    {
+      struct stat st {};
+      fstat(fd, &st);
+      size = (size_t)st.st_size;
+    }
+
+    len = size;
+    ptr = len ? (uint8_t*)mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : (uint8_t*)MAP_FAILED;
+    close(fd);
+
+    if(ptr == MAP_FAILED)
+    {
+      if(owner)
+        shm_unlink(name_);
+
+      throw runtime_error(string("can't map the shared memory '") + name_ + "'");
+    }
+  }
+
+  ~SharedMemoryDarwin()
+  {
+    munmap(ptr, len);
+
+    if(owner)
+      shm_unlink(name.c_str());
+  }
+
+  uint8_t* data() const override
+  {
+    return ptr;
+  }
+
+  size_t size() const override
+  {
+    return len;
+  }
+
+  string const name;
+  bool const owner;
+  uint8_t* ptr;
+  size_t len;
+};
+
+unique_ptr<SharedMemory> createSharedMemory(const char* name, size_t size)
+{
+  return make_unique<SharedMemoryDarwin>(name, size, true);
+}
+
+unique_ptr<SharedMemory> openSharedMemory(const char* name)
+{
+  return make_unique<SharedMemoryDarwin>(name, 0, false);
+}
+
+// macOS has no public cross-process futex: poll
+void waitForChange(atomic<uint32_t>* word, uint32_t expected, int timeoutMs)
+{
+  auto const deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+
+  while(word->load() == expected && chrono::steady_clock::now() < deadline)
+    this_thread::sleep_for(chrono::microseconds(500));
+}
+
+void wakeWaiters(atomic<uint32_t>*)
+{
+}
@@ -0,0 +1,103 @@
+// this file is GNU/Linux specific
+#include "shm.h"
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+struct SharedMemoryGnu : SharedMemory
+{
+  SharedMemoryGnu(const char* name_, size_t size, bool create)
+    : name(name_), owner(create)
+  {
+    // a new region: the readers of a previous one keep it, unchanged
+    if(create)
+      shm_unlink(name_);
+
+    auto fd = create ? shm_open(name_, O_RDWR | O_CREAT | O_EXCL, 0600) : shm_open(name_, O_RDWR, 0);
+
+    if(fd < 0)
+      throw runtime_error(string("can't open the shared memory '") + name_ + "' (" + strerror(errno) + ")");
+
+    if(create && ftruncate(fd, (off_t)size) != 0)
+    {
+      close(fd);
+      shm_unlink(name_);
+      throw runtime_error(string("can't size the shared memory '") + name_ + "' (" + strerror(errno) + ")");
+    }
+
+    if(!create)
+    {
+      struct stat st {};
+      fstat(fd, &st);
+      size = (size_t)st.st_size;
+    }
+
+    len = size;
+    ptr = len ? (uint8_t*)mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : (uint8_t*)MAP_FAILED;
+    close(fd);
+
+    if(ptr == MAP_FAILED)
+    {
+      if(owner)
+        shm_unlink(name_);
+
+      throw runtime_error(string("can't map the shared memory '") + name_ + "'");
+    }
+  }
+
+  ~SharedMemoryGnu()
+  {
+    munmap(ptr, len);
+
+    if(owner)
+      shm_unlink(name.c_str());
+  }
+
+  uint8_t* data() const override
+  {
+    return ptr;
+  }
+
+  size_t size() const override
+  {
+    return len;
+  }
+
+  string const name;
+  bool const owner;
+  uint8_t* ptr;
+  size_t len;
+};
+
+unique_ptr<SharedMemory> createSharedMemory(const char* name, size_t size)
+{
+  return make_unique<SharedMemoryGnu>(name, size, true);
+}
+
+unique_ptr<SharedMemory> openSharedMemory(const char* name)
+{
+  return make_unique<SharedMemoryGnu>(name, 0, false);
+}
+
+// not FUTEX_PRIVATE_FLAG: the waiters are in other processes
+void waitForChange(atomic<uint32_t>* word, uint32_t expected, int timeoutMs)
+{
+  timespec timeout { timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+  syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+void wakeWaiters(atomic<uint32_t>* word)
+{
+  syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
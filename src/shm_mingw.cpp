@@ -0,0 +1,92 @@
+// this file is MS Windows specific
+#include "shm.h"
+#include <windows.h>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+// The size is stored ahead of the region, as the openers can't query it.
+struct SharedMemoryMingw : SharedMemory
+{
+  SharedMemoryMingw(const char* name, size_t size, bool create)
+  {
+    if(create)
+    {
+      auto const total = (uint64_t)size + sizeof(uint64_t);
+      mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, DWORD(total >> 32), DWORD(total), name);
+    }
+    else
+      mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+
+    if(!mapping)
+      throw runtime_error(string("can't open the shared memory '") + name + "'");
+
+    // The name can't be removed while opened: the region of another writer, or the previous one
+    // still opened by its readers, whose size and content would be overwritten.
+    if(create && GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+      CloseHandle(mapping);
+      throw runtime_error(string("the shared memory '") + name + "' is already in use");
+    }
+
+    base = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+    if(!base)
+    {
+      CloseHandle(mapping);
+      throw runtime_error(string("can't map the shared memory '") + name + "'");
+    }
+
+    if(create)
+      *(uint64_t*)base = size;
+
+    len = (size_t)*(uint64_t*)base;
+  }
+
+  ~SharedMemoryMingw()
+  {
+    UnmapViewOfFile(base);
+    CloseHandle(mapping);
+  }
+
+  uint8_t* data() const override
+  {
+    return base + sizeof(uint64_t);
+  }
+
+  size_t size() const override
+  {
+    return len;
+  }
+
+  HANDLE mapping;
+  uint8_t* base;
+  size_t len;
+};
+
+// The name lives as long as a handle is opened on it.
+unique_ptr<SharedMemory> createSharedMemory(const char* name, size_t size)
+{
+  return make_unique<SharedMemoryMingw>(name, size, true);
+}
+
+unique_ptr<SharedMemory> openSharedMemory(const char* name)
+{
+  return make_unique<SharedMemoryMingw>(name, 0, false);
+}
+
+// WaitOnAddress doesn't work across processes: poll
+void waitForChange(atomic<uint32_t>* word, uint32_t expected, int timeoutMs)
+{
+  auto const deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+
+  while(word->load() == expected && chrono::steady_clock::now() < deadline)
+    this_thread::sleep_for(chrono::milliseconds(1));
+}
+
+void wakeWaiters(atomic<uint32_t>*)
+{
+}
@@ -0,0 +1,182 @@
+#include "shm_ring.h"
+#include <chrono>
+#include <cstring> // memcpy
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace ShmRing;
+
+namespace
+{
+size_t getSlotStride(uint32_t slotSize)
+{
+  auto const CacheLine = size_t(64);
+  auto const stride = sizeof(Slot) + slotSize;
+  return (stride + CacheLine - 1) / CacheLine * CacheLine;
+}
+
+size_t getHeaderSize()
+{
+  return (sizeof(Header) + 63) / 64 * 64;
+}
+}
+
+size_t ShmRing::getRegionSize(uint32_t slotCount, uint32_t slotSize)
+{
+  return getHeaderSize() + slotCount * getSlotStride(slotSize);
+}
+
+ShmRingWriter::ShmRingWriter(const char* name, int slotCount, int slotSize, const char* fourcc)
+{
+  if(slotCount <= 0 || slotSize <= 0)
+    throw runtime_error("invalid ring dimensions");
+
+  m_memory = createSharedMemory(name, getRegionSize(slotCount, slotSize));
+  m_header = new(m_memory->data()) Header {};
+  m_header->slotCount = slotCount;
+  m_header->slotSize = slotSize;
+  m_header->slotStride = (uint32_t)getSlotStride(slotSize);
+  strncpy(m_header->fourcc, fourcc, sizeof(m_header->fourcc) - 1);
+  m_header->version = Version;
+
+  // the consumers check the magic last
+  atomic_thread_fence(memory_order_release);
+  m_header->magic = Magic;
+}
+
+ShmRingWriter::~ShmRingWriter()
+{
+  m_header->closed = 1;
+  m_header->signal.fetch_add(1);
+  wakeWaiters(&m_header->signal);
+}
+
+Slot* ShmRingWriter::getSlot(uint64_t index) const
+{
+  return (Slot*)((uint8_t*)m_header + getHeaderSize() + (index % m_header->slotCount) * m_header->slotStride);
+}
+
+uint8_t* ShmRingWriter::beginWrite(size_t size)
+{
+  if(size > m_header->slotSize)
+  {
+    ++m_dropped;
+    return nullptr;
+  }
+
+  auto const n = m_header->published.load(memory_order_relaxed);
+  auto slot = getSlot(n);
+  slot->sequence.store(2 * n + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  return (uint8_t*)(slot + 1);
+}
+
+void ShmRingWriter::endWrite(size_t size, FrameInfo const& info)
+{
+  auto const n = m_header->published.load(memory_order_relaxed);
+  auto slot = getSlot(n);
+  slot->size = size;
+  slot->info = info;
+  slot->sequence.store(2 * n + 2, memory_order_release);
+  m_header->published.store(n + 1, memory_order_release);
+  m_header->signal.fetch_add(1);
+
+  // no system call when nobody waits
+  if(m_header->waiters.load())
+    wakeWaiters(&m_header->signal);
+}
+
+ShmRingReader::ShmRingReader(const char* name)
+{
+  m_memory = openSharedMemory(name);
+
+  if(m_memory->size() < sizeof(Header))
+    throw runtime_error(string("'") + name + "' isn't a frame ring");
+
+  m_header = (Header*)m_memory->data();
+
+  if(m_header->magic != Magic || m_header->version != Version)
+    throw runtime_error(string("'") + name + "' isn't a frame ring, or has an unsupported version");
+
+  atomic_thread_fence(memory_order_acquire);
+
+  if(m_memory->size() < getRegionSize(m_header->slotCount, m_header->slotSize))
+    throw runtime_error(string("'") + name + "' is truncated");
+
+  // start from the live edge
+  m_next = m_header->published.load(memory_order_acquire);
+}
+
+Slot* ShmRingReader::getSlot(uint64_t index) const
+{
+  return (Slot*)((uint8_t*)m_header + getHeaderSize() + (index % m_header->slotCount) * m_header->slotStride);
+}
+
+size_t ShmRingReader::read(uint8_t* dst, size_t dstLen, FrameInfo* info, int timeoutMs)
+{
+  auto const deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+
+  while(true)
+  {
+    auto const signal = m_header->signal.load(memory_order_acquire);
+    auto const published = m_header->published.load(memory_order_acquire);
+
+    // fell behind by more than the ring: skip to the oldest frame still there
+    if(published - m_next > m_header->slotCount)
+    {
+      m_lost += published - m_header->slotCount - m_next;
+      m_next = published - m_header->slotCount;
+    }
+
+    if(m_next < published)
+    {
+      auto slot = getSlot(m_next);
+      auto const sequence = slot->sequence.load(memory_order_acquire);
+
+      if(sequence == 2 * m_next + 2)
+      {
+        auto const size = (size_t)slot->size;
+
+        if(!dst)
+          return size;
+
+        if(size > dstLen)
+          throw runtime_error("Buffer too small");
+
+        memcpy(dst, slot + 1, size);
+        auto const frameInfo = slot->info;
+
+        // overwritten while copying?
+        atomic_thread_fence(memory_order_acquire);
+
+        if(slot->sequence.load(memory_order_relaxed) == sequence)
+        {
+          if(info)
+            *info = frameInfo;
+
+          ++m_next;
+          return size;
+        }
+      }
+
+      // overwritten: the producer went on
+      ++m_lost;
+      ++m_next;
+      continue;
+    }
+
+    if(m_header->closed)
+      return 0;
+
+    auto const now = chrono::steady_clock::now();
+
+    if(now >= deadline)
+      return 0;
+
+    auto const remainingMs = (int)chrono::duration_cast<chrono::milliseconds>(deadline - now).count();
+    m_header->waiters.fetch_add(1);
+    waitForChange(&m_header->signal, signal, max(1, remainingMs));
+    m_header->waiters.fetch_sub(1);
+  }
+}
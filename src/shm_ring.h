@@ -0,0 +1,82 @@
+#pragma once
+
+#include "lldash_play.h" // FrameInfo
+#include "shm.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Single-producer, multiple-consumer ring of frames in named shared memory.
+// The producer never waits for the consumers: each consumer follows the ring
+// at its own pace, and skips the frames overwritten before it could read them.
+// The slots are protected by sequence numbers (seqlock).
+
+namespace ShmRing
+{
+static const uint32_t Magic = 0x4c4c4452; // 'LLDR'
+static const uint32_t Version = 1;
+
+struct Header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t slotSize; // payload capacity of each slot
+  uint32_t slotStride; // distance between the slots, in bytes
+  std::atomic<uint32_t> closed; // non-zero once the producer is gone
+  std::atomic<uint64_t> published; // number of frames published
+  std::atomic<uint32_t> signal; // incremented on each publication, waited on by the consumers
+  std::atomic<uint32_t> waiters;
+  char fourcc[8];
+};
+
+struct Slot
+{
+  // 2*n+1 while frame n is being written, 2*n+2 once written
+  std::atomic<uint64_t> sequence;
+  uint64_t size;
+  FrameInfo info;
+};
+
+size_t getRegionSize(uint32_t slotCount, uint32_t slotSize);
+}
+
+struct ShmRingWriter
+{
+  ShmRingWriter(const char* name, int slotCount, int slotSize, const char* fourcc);
+  ~ShmRingWriter();
+
+  // Returns where to write a payload of 'size' bytes, or null if it doesn't fit.
+  uint8_t* beginWrite(size_t size);
+  void endWrite(size_t size, FrameInfo const& info);
+
+  uint64_t getDropped() const { return m_dropped; }
+
+  private:
+    ShmRing::Slot* getSlot(uint64_t index) const;
+
+    std::unique_ptr<SharedMemory> m_memory;
+    ShmRing::Header* m_header;
+    uint64_t m_dropped = 0; // too big for a slot
+};
+
+struct ShmRingReader
+{
+  ShmRingReader(const char* name);
+
+  // Waits up to 'timeoutMs' for the next frame.
+  // Returns its size, or zero if none. 'dst' can be null to only get the size, without consuming the frame.
+  size_t read(uint8_t* dst, size_t dstLen, FrameInfo* info, int timeoutMs);
+
+  uint64_t getLost() const { return m_lost; }
+  bool isClosed() const { return m_header->closed.load() != 0; }
+
+  private:
+    ShmRing::Slot* getSlot(uint64_t index) const;
+
+    std::unique_ptr<SharedMemory> m_memory;
+    ShmRing::Header* m_header;
+    uint64_t m_next = 0; // index of the next frame to read
+    uint64_t m_lost = 0; // overwritten before being read
+};
@@ -0,0 +1,266 @@
+// Soak test for signals-unity-bridge.so, e.g against the live simulator
+// running with an accelerated clock (see scripts/soak_test.sh).
+// Cycles create/play/grab/destroy, switching the qualities periodically,
+// and samples the process resources over time.
+// Fails if they keep growing once warmed-up.
+// GNU/Linux only: the resources are read from /proc.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "dynlib.h"
+
+// API entry points. We don't call these directly,
+// as the implementations live inside the dynamic library.
+#include "lldash_play.h"
+
+using namespace std;
+
+#define IMPORT(name) ((decltype(name)*)lib->getSymbol(# name))
+
+struct Sample
+{
+  double time; // in seconds, since the start
+  long rssKb;
+  int fds;
+  int threads;
+  int queueDepth; // frames waiting, over all the streams
+};
+
+static long getRssKb()
+{
+  long pages = 0, residentPages = 0;
+  auto f = fopen("/proc/self/statm", "r");
+
+  if(!f)
+    return -1;
+
+  if(fscanf(f, "%ld %ld", &pages, &residentPages) != 2)
+    residentPages = -1;
+
+  fclose(f);
+  return residentPages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static int getFdCount()
+{
+  auto dir = opendir("/proc/self/fd");
+
+  if(!dir)
+    return -1;
+
+  int count = 0;
+
+  while(readdir(dir))
+    ++count;
+
+  closedir(dir);
+  return count - 3; // '.', '..' and the one of 'opendir'
+}
+
+static int getThreadCount()
+{
+  auto f = fopen("/proc/self/status", "r");
+
+  if(!f)
+    return -1;
+
+  char line[256];
+  int threads = -1;
+
+  while(fgets(line, sizeof line, f))
+    if(sscanf(line, "Threads: %d", &threads) == 1)
+      break;
+
+  fclose(f);
+  return threads;
+}
+
+void safeMain(int argc, char* argv[])
+{
+  if(argc < 3 || argc > 5)
+    throw runtime_error("Usage: soak.exe <my_library> <my_url> [duration in seconds] [session duration in seconds]");
+
+  auto libName = argv[1];
+  auto url = argv[2];
+  auto const duration = chrono::seconds(argc > 3 ? atoi(argv[3]) : 600);
+  auto const sessionDuration = chrono::seconds(argc > 4 ? atoi(argv[4]) : 30);
+  auto const switchPeriod = chrono::seconds(2);
+  auto const samplePeriod = chrono::seconds(1);
+
+  auto lib = loadLibrary(libName);
+  auto func_lldplay_create = IMPORT(lldplay_create);
+  auto func_lldplay_destroy = IMPORT(lldplay_destroy);
+  auto func_lldplay_play = IMPORT(lldplay_play);
+  auto func_lldplay_get_stream_count = IMPORT(lldplay_get_stream_count);
+  auto func_lldplay_get_stream_stats = IMPORT(lldplay_get_stream_stats);
+  auto func_lldplay_enable_stream = IMPORT(lldplay_enable_stream);
+  auto func_lldplay_disable_stream = IMPORT(lldplay_disable_stream);
+  auto func_lldplay_grab_frame = IMPORT(lldplay_grab_frame);
+
+  vector<Sample> samples; // during the sessions
+  vector<Sample> idleSamples; // between the sessions: nothing should remain
+  vector<uint8_t> buffer(10 * 1024 * 1024);
+
+  auto const start = chrono::steady_clock::now();
+  auto elapsed = [&] () { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+
+  printf("time_s,rss_kb,fds,threads,queue_depth\n");
+
+  int session = 0;
+  int64_t totalFrames = 0;
+
+  while(chrono::steady_clock::now() - start < duration)
+  {
+    auto pipeline = func_lldplay_create("SoakPipeline", nullptr, 0, LLDASH_PLAYOUT_API_VERSION, nullptr);
+
+    if(!pipeline || !func_lldplay_play(pipeline, url))
+      throw runtime_error("can't play '" + string(url) + "'");
+
+    auto const streamCount = func_lldplay_get_stream_count(pipeline);
+    auto const sessionStart = chrono::steady_clock::now();
+    auto nextSwitch = sessionStart + switchPeriod;
+    auto nextSample = sessionStart + samplePeriod;
+    int switchCount = 0;
+
+    while(chrono::steady_clock::now() - sessionStart < sessionDuration)
+    {
+      for(int j = 0; j < streamCount; ++j)
+      {
+        FrameInfo info {};
+
+        while(func_lldplay_grab_frame(pipeline, j, buffer.data(), buffer.size(), &info))
+          ++totalFrames;
+      }
+
+      auto const now = chrono::steady_clock::now();
+
+      // toggle one tile at a time, always keeping one enabled
+      if(now >= nextSwitch && streamCount > 1)
+      {
+        auto const tile = 1 + switchCount % (streamCount - 1);
+
+        if((switchCount / (streamCount - 1)) % 2)
+          func_lldplay_enable_stream(pipeline, tile, 0);
+        else
+          func_lldplay_disable_stream(pipeline, tile);
+
+        ++switchCount;
+        nextSwitch = now + switchPeriod;
+      }
+
+      if(now >= nextSample)
+      {
+        Sample s { elapsed(), getRssKb(), getFdCount(), getThreadCount(), 0 };
+
+        for(int j = 0; j < streamCount; ++j)
+        {
+          StreamStats stats {};
+
+          if(func_lldplay_get_stream_stats(pipeline, j, &stats))
+            s.queueDepth += stats.queuedFrames;
+        }
+
+        printf("%.1f,%ld,%d,%d,%d\n", s.time, s.rssKb, s.fds, s.threads, s.queueDepth);
+        fflush(stdout);
+        samples.push_back(s);
+        nextSample = now + samplePeriod;
+      }
+
+      this_thread::sleep_for(chrono::milliseconds(5));
+    }
+
+    func_lldplay_destroy(pipeline);
+    ++session;
+
+    // let the OS reclaim the threads
+    this_thread::sleep_for(chrono::milliseconds(200));
+    idleSamples.push_back({ elapsed(), getRssKb(), getFdCount(), getThreadCount(), 0 });
+  }
+
+  fprintf(stderr, "%d sessions, %lld frames\n", session, (long long)totalFrames);
+
+  if(!totalFrames)
+    throw runtime_error("no frame received");
+
+  if(idleSamples.size() < 3)
+    throw runtime_error("too few sessions to detect any growth: increase the duration");
+
+  // The first session warms up (allocator pools, lazy init, ...).
+  // The idle state must then be stable, and the RSS can't creep more than a margin.
+  auto const& ref = idleSamples[1];
+  auto const& last = idleSamples.back();
+  auto const rssMarginKb = max(16L * 1024, ref.rssKb / 5);
+
+  fprintf(stderr, "idle after warm-up: rss=%ldkB fds=%d threads=%d\n", ref.rssKb, ref.fds, ref.threads);
+  fprintf(stderr, "idle at the end:    rss=%ldkB fds=%d threads=%d\n", last.rssKb, last.fds, last.threads);
+
+  bool failed = false;
+
+  if(last.rssKb > ref.rssKb + rssMarginKb)
+  {
+    fprintf(stderr, "FAIL: the RSS grew by %ldkB\n", last.rssKb - ref.rssKb);
+    failed = true;
+  }
+
+  if(last.fds > ref.fds)
+  {
+    fprintf(stderr, "FAIL: %d file descriptors leaked\n", last.fds - ref.fds);
+    failed = true;
+  }
+
+  if(last.threads > ref.threads)
+  {
+    fprintf(stderr, "FAIL: %d threads leaked\n", last.threads - ref.threads);
+    failed = true;
+  }
+
+  // queue creep: compare the average depth of the first and last quarters of the run
+  if(samples.size() >= 8)
+  {
+    auto average = [&] (size_t begin, size_t end)
+      {
+        double sum = 0;
+
+        for(auto i = begin; i < end; ++i)
+          sum += samples[i].queueDepth;
+
+        return sum / (end - begin);
+      };
+
+    auto const quarter = samples.size() / 4;
+    auto const first = average(0, quarter);
+    auto const lastQuarter = average(samples.size() - quarter, samples.size());
+    fprintf(stderr, "average queue depth: %.1f (first quarter), %.1f (last quarter)\n", first, lastQuarter);
+
+    if(lastQuarter > first * 2 + 8)
+    {
+      fprintf(stderr, "FAIL: the queues are creeping\n");
+      failed = true;
+    }
+  }
+
+  if(failed)
+    throw runtime_error("resource growth detected");
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    safeMain(argc, argv);
+    return 0;
+  }
+  catch(exception const& e)
+  {
+    fprintf(stderr, "Fatal: %s\n", e.what());
+    return 1;
+  }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// Scheduling policy of the pipeline threads.
+struct ThreadPolicy
+{
+  // bit N allows CPU N. Zero means no restriction.
+  uint64_t cpuMask = 0;
+
+  // nice-like: from -20 (highest) to 19 (lowest), 0 being the default priority.
+  int priority = 0;
+};
+
+// Applies a policy to the calling thread.
+// On GNU/Linux, the threads it creates afterwards inherit it.
+// Returns false if (part of) the policy couldn't be applied,
+// e.g raising the priority usually requires privileges.
+bool setThreadPolicy(ThreadPolicy const& policy);
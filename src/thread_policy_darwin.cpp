@@ -0,0 +1,36 @@
+// this file is macOS specific
+#include "thread_policy.h"
+#include <pthread.h>
+#include <sched.h>
+
+bool setThreadPolicy(ThreadPolicy const& policy)
+{
+  bool ok = true;
+
+  // macOS has no way to pin a thread to a CPU
+  if(policy.cpuMask)
+    ok = false;
+
+  if(policy.priority)
+  {
+    sched_param param {};
+    int schedPolicy = 0;
+
+    if(pthread_getschedparam(pthread_self(), &schedPolicy, &param))
+      return false;
+
+    // map the nice-like value to the range of the current policy
+    auto const minPrio = sched_get_priority_min(schedPolicy);
+    auto const maxPrio = sched_get_priority_max(schedPolicy);
+    auto const defaultPrio = param.sched_priority;
+
+    if(policy.priority < 0)
+      param.sched_priority = defaultPrio + (maxPrio - defaultPrio) * -policy.priority / 20;
+    else
+      param.sched_priority = defaultPrio - (defaultPrio - minPrio) * policy.priority / 19;
+
+    ok &= pthread_setschedparam(pthread_self(), schedPolicy, &param) == 0;
+  }
+
+  return ok;
+}
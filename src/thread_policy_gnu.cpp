@@ -0,0 +1,30 @@
+// this file is GNU/Linux specific
+#include "thread_policy.h"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+bool setThreadPolicy(ThreadPolicy const& policy)
+{
+  bool ok = true;
+
+  if(policy.cpuMask)
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for(int cpu = 0; cpu < 64; ++cpu)
+      if(policy.cpuMask & (1ULL << cpu))
+        CPU_SET(cpu, &set);
+
+    ok &= pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+  }
+
+  // the nice value is per-thread on Linux
+  if(policy.priority)
+    ok &= setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), policy.priority) == 0;
+
+  return ok;
+}
@@ -0,0 +1,29 @@
+// this file is MS Windows specific
+#include "thread_policy.h"
+#include <windows.h>
+
+bool setThreadPolicy(ThreadPolicy const& policy)
+{
+  bool ok = true;
+
+  if(policy.cpuMask)
+    ok &= SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)policy.cpuMask) != 0;
+
+  if(policy.priority)
+  {
+    int prio = THREAD_PRIORITY_NORMAL;
+
+    if(policy.priority <= -15)
+      prio = THREAD_PRIORITY_HIGHEST;
+    else if(policy.priority < 0)
+      prio = THREAD_PRIORITY_ABOVE_NORMAL;
+    else if(policy.priority >= 15)
+      prio = THREAD_PRIORITY_LOWEST;
+    else
+      prio = THREAD_PRIORITY_BELOW_NORMAL;
+
+    ok &= SetThreadPriority(GetCurrentThread(), prio) != 0;
+  }
+
+  return ok;
+}
@@ -0,0 +1,278 @@
+#include "tracer.h"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+atomic<bool> g_tracing { false };
+
+namespace
+{
+auto const MaxEventsPerThread = 16 * 1024;
+
+struct TraceEvent
+{
+  const char* category;
+  const char* name;
+  char phase; // 'X': span, 'i': instant, 'b'/'e': async span
+  int tile;
+  uint64_t id;
+  int64_t ts; // in microseconds
+  int64_t dur;
+  char detail[96];
+};
+
+// Written by its thread only. Read when the trace is stopped.
+struct ThreadBuffer
+{
+  int tid;
+  int generation;
+  atomic<int> count { 0 };
+  atomic<int> dropped { 0 };
+  TraceEvent events[MaxEventsPerThread];
+};
+
+mutex g_mutex; // protects below members
+string g_path;
+int g_nextTid = 1;
+vector<shared_ptr<ThreadBuffer>> g_buffers;
+
+// read without locking by the tracing threads
+atomic<int> g_generation { 0 };
+atomic<int64_t> g_origin { 0 }; // in steady clock microseconds
+
+thread_local shared_ptr<ThreadBuffer> t_buffer;
+
+int64_t toUs(chrono::steady_clock::time_point t)
+{
+  return chrono::duration_cast<chrono::microseconds>(t.time_since_epoch()).count() - g_origin;
+}
+
+ThreadBuffer* getBuffer()
+{
+  // register once per thread and per trace
+  if(!t_buffer || t_buffer->generation != g_generation)
+  {
+    unique_lock<mutex> lock(g_mutex);
+
+    if(!g_tracing)
+      return nullptr;
+
+    t_buffer = make_shared<ThreadBuffer>();
+    t_buffer->tid = g_nextTid++;
+    t_buffer->generation = g_generation;
+    g_buffers.push_back(t_buffer);
+  }
+
+  return t_buffer.get();
+}
+
+TraceEvent* newEvent()
+{
+  auto buf = getBuffer();
+
+  if(!buf)
+    return nullptr;
+
+  auto const n = buf->count.load(memory_order_relaxed);
+
+  if(n >= MaxEventsPerThread)
+  {
+    buf->dropped++;
+    return nullptr;
+  }
+
+  return &buf->events[n];
+}
+
+// publishes the event filled by the last call to 'newEvent'
+void commitEvent()
+{
+  t_buffer->count.fetch_add(1, memory_order_release);
+}
+
+void setDetail(TraceEvent* e, const char* detail)
+{
+  if(!detail)
+  {
+    e->detail[0] = 0;
+    return;
+  }
+
+  // keep the end of long strings (e.g the segment name of an URL)
+  auto const len = strlen(detail);
+  auto const maxLen = sizeof e->detail - 1;
+  auto const src = len > maxLen ? detail + len - maxLen : detail;
+  memcpy(e->detail, src, min(len, maxLen) + 1);
+}
+
+void writeEscaped(FILE* f, const char* s)
+{
+  for(; *s; ++s)
+  {
+    if(*s == '"' || *s == '\\')
+      fputc('\\', f);
+
+    if((unsigned char)*s < 0x20)
+      continue;
+
+    fputc(*s, f);
+  }
+}
+
+void writeEvent(FILE* f, int tid, TraceEvent const& e)
+{
+  fprintf(f, ",\n{\"cat\":\"%s\",\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%lld",
+          e.category, e.name, e.phase, tid, (long long)e.ts);
+
+  if(e.phase == 'X')
+    fprintf(f, ",\"dur\":%lld", (long long)e.dur);
+
+  if(e.phase == 'i')
+    fprintf(f, ",\"s\":\"t\"");
+
+  if(e.phase == 'b' || e.phase == 'e')
+    fprintf(f, ",\"id\":\"0x%llx\"", (unsigned long long)e.id);
+
+  fprintf(f, ",\"args\":{\"tile\":%d", e.tile);
+
+  if(e.detail[0])
+  {
+    fprintf(f, ",\"detail\":\"");
+    writeEscaped(f, e.detail);
+    fprintf(f, "\"");
+  }
+
+  fprintf(f, "}}");
+}
+}
+
+bool traceStart(const char* path)
+{
+  unique_lock<mutex> lock(g_mutex);
+
+  if(g_tracing)
+    return false;
+
+  g_path = path;
+  g_origin = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+  g_buffers.clear();
+  ++g_generation;
+  g_tracing = true;
+  return true;
+}
+
+void traceStop()
+{
+  vector<shared_ptr<ThreadBuffer>> buffers;
+  string path;
+
+  {
+    unique_lock<mutex> lock(g_mutex);
+
+    if(!g_tracing)
+      return;
+
+    g_tracing = false;
+    buffers.swap(g_buffers);
+    path = g_path;
+  }
+
+  auto f = fopen(path.c_str(), "w");
+
+  if(!f)
+  {
+    fprintf(stderr, "[tracer] can't write '%s'\n", path.c_str());
+    return;
+  }
+
+  fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"lldash-playout\"}}");
+
+  for(auto& buf : buffers)
+  {
+    fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread #%d\"}}", buf->tid, buf->tid);
+
+    // events being written concurrently are left out
+    auto const count = buf->count.load(memory_order_acquire);
+
+    for(int i = 0; i < count; ++i)
+      writeEvent(f, buf->tid, buf->events[i]);
+
+    if(buf->dropped)
+      fprintf(stderr, "[tracer] thread #%d: %d events dropped (buffer full)\n", buf->tid, buf->dropped.load());
+  }
+
+  fprintf(f, "\n]}\n");
+  fclose(f);
+}
+
+void traceSpan(const char* category, const char* name, chrono::steady_clock::time_point start, chrono::steady_clock::time_point end, int tile, const char* detail)
+{
+  if(!isTracing())
+    return;
+
+  auto e = newEvent();
+
+  if(!e)
+    return;
+
+  e->category = category;
+  e->name = name;
+  e->phase = 'X';
+  e->tile = tile;
+  e->id = 0;
+  e->ts = toUs(start);
+  e->dur = toUs(end) - e->ts;
+  setDetail(e, detail);
+  commitEvent();
+}
+
+void traceInstant(const char* category, const char* name, int tile, const char* detail)
+{
+  if(!isTracing())
+    return;
+
+  auto e = newEvent();
+
+  if(!e)
+    return;
+
+  e->category = category;
+  e->name = name;
+  e->phase = 'i';
+  e->tile = tile;
+  e->id = 0;
+  e->ts = toUs(chrono::steady_clock::now());
+  e->dur = 0;
+  setDetail(e, detail);
+  commitEvent();
+}
+
+void traceAsyncSpan(const char* category, const char* name, uint64_t id, chrono::steady_clock::time_point start, chrono::steady_clock::time_point end, int tile)
+{
+  if(!isTracing())
+    return;
+
+  for(auto phase : { 'b', 'e' })
+  {
+    auto e = newEvent();
+
+    if(!e)
+      return;
+
+    e->category = category;
+    e->name = name;
+    e->phase = phase;
+    e->tile = tile;
+    e->id = id;
+    e->ts = toUs(phase == 'b' ? start : end);
+    e->dur = 0;
+    e->detail[0] = 0;
+    commitEvent();
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Timeline of the session activity, written as a Chrome trace-event JSON file
+// (chrome://tracing, https://ui.perfetto.dev).
+// Each thread records into its own buffer, without locking: tracing only costs
+// a relaxed load while disabled, and a few stores while enabled.
+// The events are written to the file when the trace is stopped.
+// There is at most one trace per process.
+
+extern std::atomic<bool> g_tracing;
+
+inline bool isTracing()
+{
+  return g_tracing.load(std::memory_order_relaxed);
+}
+
+// Returns false if a trace is already running.
+bool traceStart(const char* path);
+
+// Writes the trace file.
+void traceStop();
+
+// 'category' and 'name' must be string literals (only the pointers are recorded).
+// 'tile' is -1 when not applicable. 'detail' is copied, and truncated if too long.
+void traceSpan(const char* category, const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, int tile, const char* detail = nullptr);
+void traceInstant(const char* category, const char* name, int tile, const char* detail = nullptr);
+
+// A span which can overlap others of the same name (e.g the frames waiting in a queue).
+void traceAsyncSpan(const char* category, const char* name, uint64_t id, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, int tile);
@@ -1,15 +1,54 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <string>
 #include <vector>
 #include <future>
+#include <thread>
 #include "lldash_play.h"
 
 using namespace std;
 
+// Grabs a frame, retrying every 10ms for up to 'timeoutMs'.
+// Returns the frame size, or 0 if none came in time.
+static size_t grabWithTimeout(lldplay_handle* h, int stream, vector<uint8_t>& buffer, FrameInfo* info, int timeoutMs)
+{
+  auto const deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+
+  while(true)
+  {
+    auto const size = lldplay_grab_frame(h, stream, buffer.data(), buffer.size(), info);
+
+    if(size || chrono::steady_clock::now() >= deadline)
+      return size;
+
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+}
+
+// Same for a frame set. Returns its entry count, or 0 if none came in time.
+static int grabFrameSetWithTimeout(lldplay_handle* h, vector<uint8_t>& buffer, FrameSetEntry* entries, int maxEntries, int64_t* timestamp, int timeoutMs)
+{
+  auto const deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+
+  while(true)
+  {
+    auto const count = lldplay_grab_frameset(h, buffer.data(), buffer.size(), entries, maxEntries, timestamp);
+
+    if(count || chrono::steady_clock::now() >= deadline)
+      return count;
+
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+}
+
 int main(int argc, char* argv[])
 {
   {
-    auto pipeline = lldplay_create("MyPipeline");
-    auto playbackSuccessful = lldplay_play(pipeline, "http://example.com/I_dont_exist.mpd");
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    auto playbackSuccessful = lldplay_play(pipeline, "http://127.0.0.1:1/I_dont_exist.mpd");
     lldplay_destroy(pipeline);
 
     assert(!playbackSuccessful);
@@ -20,13 +59,13 @@ int main(int argc, char* argv[])
     vector<lldplay_handle*> pipelines;
 
     for(int i=0;i < 2;++i)
-      pipelines.push_back(lldplay_create("MyPipeline"));
+      pipelines.push_back(lldplay_create("MyPipeline", nullptr, 2));
 
     for(auto pipeline : pipelines)
     {
       auto play = [pipeline]()
       {
-        lldplay_play(pipeline, "http://example.com/I_dont_exist.mpd");
+        lldplay_play(pipeline, "http://127.0.0.1:1/I_dont_exist.mpd");
       };
 
       std::async(std::launch::async, play);
@@ -36,5 +75,700 @@ int main(int argc, char* argv[])
       lldplay_destroy(pipeline);
   }
 
+  // local MP4 file
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    auto playbackSuccessful = lldplay_play(pipeline, "data/test.mp4");
+    assert(playbackSuccessful);
+    assert(lldplay_get_stream_count(pipeline) == 1);
+
+    StreamDesc desc {};
+    lldplay_get_stream_info(pipeline, 0, &desc);
+    assert(memcmp(&desc.MP4_4CC, "avc1", 4) == 0);
+
+    vector<uint8_t> buffer(1024 * 1024);
+    FrameInfo info {};
+    auto const size = grabWithTimeout(pipeline, 0, buffer, &info, 1000);
+
+    assert(size == 4208);
+    assert(info.timestamp == 0);
+    assert(info.dsi_size > 0);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // seek in a local MP4 file
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    assert(lldplay_seek(pipeline, 15000));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    FrameInfo info {};
+    auto const size = grabWithTimeout(pipeline, 0, buffer, &info, 1000);
+
+    // resumes from the preceding sync sample
+    assert(size > 0);
+    assert(info.timestamp == 10000);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // local files are paced in real-time by default
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    int frameCount = 0;
+
+    for(int i = 0; i < 50; ++i)
+    {
+      while(lldplay_grab_frame(pipeline, 0, buffer.data(), buffer.size(), nullptr))
+        ++frameCount;
+
+      this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    // 25 fps: ~13 frames in 500ms, plus the lookahead
+    assert(frameCount > 0);
+    assert(frameCount < 50);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // as fast as possible
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_set_pacing(pipeline, 0, 0));
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    int frameCount = 0;
+
+    for(int i = 0; i < 1000 && frameCount < 750; ++i)
+    {
+      while(lldplay_grab_frame(pipeline, 0, buffer.data(), buffer.size(), nullptr))
+        ++frameCount;
+
+      this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    assert(frameCount == 750);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // a paced source doesn't slow down an unpaced one
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    auto const unpaced = lldplay_add_source(pipeline, "data/test.mp4");
+    assert(unpaced >= 0);
+    assert(lldplay_set_source_pacing(pipeline, unpaced, 0, 0));
+    assert(!lldplay_set_source_pacing(pipeline, unpaced + 1, 0, 0));
+
+    int first = -1, count = 0;
+    assert(lldplay_get_source_streams(pipeline, unpaced, &first, &count));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    int pacedCount = 0;
+    int unpacedCount = 0;
+
+    // the file lasts 30s at 25 fps: all of it within 10s isn't real-time
+    for(int i = 0; i < 1000 && unpacedCount < 750; ++i)
+    {
+      while(lldplay_grab_frame(pipeline, 0, buffer.data(), buffer.size(), nullptr))
+        ++pacedCount;
+
+      while(lldplay_grab_frame(pipeline, first, buffer.data(), buffer.size(), nullptr))
+        ++unpacedCount;
+
+      this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    assert(unpacedCount == 750);
+    assert(pacedCount > 0);
+    assert(pacedCount < 750);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // allocation-free delivery
+  {
+    LLDashPlayoutOptions options {};
+    options.version = LLDASH_PLAYOUT_OPTIONS_VERSION;
+    options.framesPerStream = 16;
+
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2, LLDASH_PLAYOUT_API_VERSION, &options);
+    assert(lldplay_set_pacing(pipeline, 0, 0));
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    FrameInfo info {};
+    int frameCount = 0;
+    StreamStats warm {};
+    int warmChecks = 0;
+
+    for(int i = 0; i < 1000 && frameCount < 750; ++i)
+    {
+      while(lldplay_grab_frame(pipeline, 0, buffer.data(), buffer.size(), &info))
+        ++frameCount;
+
+      // past the warm-up, the frames only go through the preallocated buffers
+      StreamStats current {};
+      assert(lldplay_get_stream_stats(pipeline, 0, &current));
+
+      if(frameCount < 64)
+        warm = current;
+      else
+      {
+        assert(current.allocations == warm.allocations);
+        assert(current.poolExhaustions == warm.poolExhaustions);
+        ++warmChecks;
+      }
+
+      this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    assert(warmChecks > 0);
+
+    StreamStats stats {};
+    assert(lldplay_get_stream_stats(pipeline, 0, &stats));
+    assert(stats.framesReceived == 750);
+    assert(stats.queuedFrames == 0);
+    assert(stats.queueCapacity == 16);
+    assert(stats.allocations == 0);
+    assert(stats.poolExhaustions == 0);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // frame sets
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    assert(lldplay_set_frameset_deadline(pipeline, 50));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    FrameSetEntry entries[4];
+    int64_t timestamp = -1;
+    auto const count = grabFrameSetWithTimeout(pipeline, buffer, entries, 4, &timestamp, 1000);
+
+    assert(count == 1);
+    assert(timestamp == 0);
+    assert(entries[0].tileNumber == 0);
+    assert(!entries[0].missing);
+    assert(entries[0].offset == 0);
+    assert(entries[0].size == 4208);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // frame sets, without the unsubscribed streams
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    assert(lldplay_add_source(pipeline, "data/test.mp4") >= 0);
+    assert(lldplay_subscribe(pipeline, 1, false));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    FrameSetEntry entries[4];
+    auto const count = grabFrameSetWithTimeout(pipeline, buffer, entries, 4, nullptr, 1000);
+
+    assert(count == 1);
+    assert(entries[0].tileNumber == 0);
+    assert(!entries[0].missing);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // several sources in one pipeline
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    auto const second = lldplay_add_source(pipeline, "data/test.mp4");
+    assert(second >= 0);
+    assert(lldplay_get_stream_count(pipeline) == 2);
+
+    int first = -1, count = 0;
+    assert(lldplay_get_source_streams(pipeline, second, &first, &count));
+    assert(first == 1);
+    assert(count == 1);
+
+    vector<uint8_t> buffer(1024 * 1024);
+    auto const size = grabWithTimeout(pipeline, first, buffer, nullptr, 1000);
+
+    assert(size == 4208);
+
+    assert(lldplay_remove_source(pipeline, second));
+    assert(!lldplay_remove_source(pipeline, second));
+    assert(lldplay_get_stream_count(pipeline) == 2);
+    assert(lldplay_grab_frame(pipeline, first, buffer.data(), buffer.size(), nullptr) == 0);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // creation options
+  {
+    LLDashPlayoutOptions options {};
+    options.version = LLDASH_PLAYOUT_OPTIONS_VERSION;
+    options.threading = LLDPLAY_THREADING_SINGLE;
+    options.cpuAffinityMask = 0x1;
+    options.threadPriority = 5;
+
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2, LLDASH_PLAYOUT_API_VERSION, &options);
+    assert(pipeline);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    auto const size = grabWithTimeout(pipeline, 0, buffer, nullptr, 1000);
+
+    assert(size == 4208);
+
+    lldplay_destroy(pipeline);
+
+    options.version = LLDASH_PLAYOUT_OPTIONS_VERSION + 1;
+    assert(!lldplay_create("MyPipeline", nullptr, 2, LLDASH_PLAYOUT_API_VERSION, &options));
+  }
+
+  // download scheduling
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(!lldplay_set_stream_priority(pipeline, 0, 1));
+    assert(lldplay_set_max_downloads(pipeline, 4));
+    assert(!lldplay_set_max_downloads(pipeline, -1));
+    assert(lldplay_set_fast_switch(pipeline, true));
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    assert(lldplay_set_stream_priority(pipeline, 0, 1));
+
+    // local files aren't adaptive: nothing switches
+    assert(lldplay_enable_stream(pipeline, 0, 1));
+    StreamStats stats {};
+    assert(lldplay_get_stream_stats(pipeline, 0, &stats));
+    assert(stats.switches == 0);
+    assert(stats.fastSwitches == 0);
+
+    // local files don't download anything
+    DownloadTiming timings[8];
+    assert(lldplay_get_download_timings(pipeline, timings, 8) == 0);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // a failed download isn't reported as successful
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(!lldplay_play(pipeline, "http://127.0.0.1:1/I_dont_exist.mpd"));
+
+    DownloadTiming timings[8];
+    auto const count = lldplay_get_download_timings(pipeline, timings, 8);
+    assert(count >= 1);
+
+    for(int i = 0; i < count; ++i)
+      assert(!timings[i].ok && timings[i].bytes == 0);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // tracing
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(!lldplay_set_trace(pipeline, nullptr));
+    assert(lldplay_set_trace(pipeline, "test-trace.json"));
+    assert(!lldplay_set_trace(pipeline, "test-trace.json"));
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    auto const size = grabWithTimeout(pipeline, 0, buffer, nullptr, 1000);
+
+    assert(size);
+    assert(lldplay_set_trace(pipeline, nullptr));
+
+    auto f = fopen("test-trace.json", "r");
+    assert(f);
+    auto const len = fread(buffer.data(), 1, buffer.size() - 1, f);
+    fclose(f);
+    buffer[len] = 0;
+    assert(strstr((const char*)buffer.data(), "\"traceEvents\""));
+    assert(strstr((const char*)buffer.data(), "\"enqueue\""));
+    assert(strstr((const char*)buffer.data(), "\"grab\""));
+    remove("test-trace.json");
+
+    lldplay_destroy(pipeline);
+  }
+
+  // reconnect policy
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_set_reconnect_policy(pipeline, 1000, 100, 2000));
+    assert(lldplay_set_reconnect_policy(pipeline, 0, 100, 100));
+    assert(!lldplay_set_reconnect_policy(pipeline, 1000, 2000, 100));
+    assert(!lldplay_set_reconnect_policy(pipeline, -1, 100, 2000));
+    lldplay_destroy(pipeline);
+  }
+
+  // Annex-B output
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    assert(!lldplay_set_frame_format(pipeline, 0, 3));
+    assert(!lldplay_set_frame_format(pipeline, 1, LLDPLAY_FRAME_FORMAT_ANNEXB));
+    assert(lldplay_set_frame_format(pipeline, 0, LLDPLAY_FRAME_FORMAT_ANNEXB_WITH_PARAMS));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    auto const size = grabWithTimeout(pipeline, 0, buffer, nullptr, 1000);
+
+    // the first frame is a keyframe: it starts with the SPS
+    assert(size > 5);
+    assert(buffer[0] == 0 && buffer[1] == 0 && buffer[2] == 0 && buffer[3] == 1);
+    assert((buffer[4] & 0x1f) == 7);
+
+    lldplay_destroy(pipeline);
+  }
+
+  // Annex-B output: a corrupt frame is dropped, and doesn't block the stream
+  {
+    vector<uint8_t> file;
+
+    {
+      auto f = fopen("data/test.mp4", "rb");
+      assert(f);
+      uint8_t buf[4096];
+      size_t n;
+
+      while((n = fread(buf, 1, sizeof buf, f)) > 0)
+        file.insert(file.end(), buf, buf + n);
+
+      fclose(f);
+    }
+
+    // the first sample starts the 'mdat' payload: its first NAL unit now exceeds the sample
+    static const char mdat[] = "mdat";
+    auto const payload = search(file.begin(), file.end(), mdat, mdat + 4) + 4;
+    assert(payload < file.end() - 4);
+    fill(payload, payload + 4, 0xff);
+
+    {
+      auto f = fopen("corrupt.mp4", "wb");
+      assert(f);
+      fwrite(file.data(), 1, file.size(), f);
+      fclose(f);
+    }
+
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "corrupt.mp4"));
+    assert(lldplay_set_frame_format(pipeline, 0, LLDPLAY_FRAME_FORMAT_ANNEXB));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    FrameInfo info {};
+    int grabbed = 0;
+    int64_t firstTimestamp = -1;
+
+    for(int i = 0; i < 200 && grabbed < 3; ++i)
+    {
+      if(lldplay_grab_frame(pipeline, 0, buffer.data(), buffer.size(), &info))
+      {
+        if(!grabbed++)
+          firstTimestamp = info.timestamp;
+      }
+      else
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    // the first frame (timestamp 0) was dropped
+    assert(grabbed == 3);
+    assert(firstTimestamp > 0);
+
+    lldplay_destroy(pipeline);
+    remove("corrupt.mp4");
+  }
+
+  // record and replay
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(!lldplay_set_record(pipeline, "I_dont_exist/capture"));
+    assert(!lldplay_set_replay(pipeline, "I_dont_exist/capture", 1.0));
+    assert(!lldplay_set_replay(pipeline, ".", -1.0));
+    assert(lldplay_set_record(pipeline, "."));
+    assert(lldplay_set_record(pipeline, nullptr));
+
+    // nothing was recorded: an empty capture, not an error
+    assert(lldplay_set_replay(pipeline, ".", 1.0));
+    assert(lldplay_set_replay(pipeline, nullptr, 1.0));
+    lldplay_destroy(pipeline);
+    remove("capture.txt");
+    remove("capture.bin");
+  }
+
+  // libav profiles
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(!lldplay_set_libav_profile(pipeline, 2, nullptr));
+    assert(lldplay_set_libav_profile(pipeline, LLDPLAY_LIBAV_LOW_LATENCY, nullptr));
+    assert(lldplay_set_libav_profile(pipeline, LLDPLAY_LIBAV_DEFAULT, "-rtsp_transport tcp"));
+    lldplay_destroy(pipeline);
+  }
+
+  // shared-memory export
+  {
+    assert(!lldplay_shm_open("/lldash-test-I_dont_exist"));
+
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    assert(!lldplay_export_stream(pipeline, 1, "/lldash-test-export", 16, 1024 * 1024));
+    assert(lldplay_export_stream(pipeline, 0, "/lldash-test-export", 16, 1024 * 1024));
+
+    auto reader = lldplay_shm_open("/lldash-test-export");
+    assert(reader);
+
+    vector<uint8_t> buffer(1024 * 1024);
+    FrameInfo info {};
+    assert(lldplay_shm_read(reader, buffer.data(), buffer.size(), &info, 2000));
+
+    // the exported frames don't go through the queue anymore
+    assert(lldplay_grab_frame(pipeline, 0, buffer.data(), buffer.size(), nullptr) == 0);
+
+    assert(lldplay_export_stream(pipeline, 0, nullptr, 0, 0));
+    lldplay_shm_close(reader);
+    lldplay_destroy(pipeline);
+  }
+
+  // subscriptions
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    assert(!lldplay_subscribe(pipeline, 1, false));
+    assert(lldplay_subscribe(pipeline, 0, false));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    this_thread::sleep_for(chrono::milliseconds(300));
+    assert(lldplay_grab_frame(pipeline, 0, buffer.data(), buffer.size(), nullptr) == 0);
+
+    assert(lldplay_subscribe(pipeline, 0, true));
+    assert(grabWithTimeout(pipeline, 0, buffer, nullptr, 1000));
+    lldplay_destroy(pipeline);
+  }
+
+  // channel switching
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(!lldplay_switch(pipeline, "data/test.mp4")); // not playing yet
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    auto const streamCount = lldplay_get_stream_count(pipeline);
+
+    assert(lldplay_switch(pipeline, "data/test.mp4"));
+    assert(lldplay_get_stream_count(pipeline) == streamCount);
+
+    vector<uint8_t> buffer(1024 * 1024);
+    assert(grabWithTimeout(pipeline, 0, buffer, nullptr, 1000));
+    lldplay_destroy(pipeline);
+  }
+
+  // channel switching, while the streams are being inspected
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+
+    atomic<bool> switching { true };
+    thread inspector([&] ()
+      {
+        while(switching)
+        {
+          StreamStats stats {};
+          StreamDesc desc {};
+          lldplay_get_stream_stats(pipeline, 0, &stats);
+          lldplay_get_stream_info(pipeline, 0, &desc);
+        }
+      });
+
+    for(int i = 0; i < 20; ++i)
+      assert(lldplay_switch(pipeline, "data/test.mp4"));
+
+    switching = false;
+    inspector.join();
+    lldplay_destroy(pipeline);
+  }
+
+  // probe, without playing
+  {
+    struct Probe
+    {
+      int streamCount = 0;
+      uint32_t fourcc = 0;
+      int cached = 0;
+    };
+
+    auto onProbe = [] (void* userData, const StreamDesc* streams, int streamCount, const ProbeInfo* info)
+      {
+        auto probe = (Probe*)userData;
+        probe->streamCount = streamCount;
+        probe->fourcc = streamCount ? streams[0].MP4_4CC : 0;
+        probe->cached = info->cached;
+      };
+
+    Probe probe;
+    assert(lldplay_probe("data/test.mp4", onProbe, &probe, 0));
+    assert(probe.streamCount > 0 && !probe.cached);
+
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    assert(lldplay_get_stream_count(pipeline) == probe.streamCount);
+    StreamDesc desc {};
+    assert(lldplay_get_stream_info(pipeline, 0, &desc));
+    assert(desc.MP4_4CC == probe.fourcc);
+    lldplay_destroy(pipeline);
+
+    assert(lldplay_probe("data/test.mp4", onProbe, &probe, 60000));
+    assert(probe.cached);
+
+    // the cache is bounded: the least recently used URL goes first ("data/./test.mp4", ...)
+    string url = "data/test.mp4";
+
+    for(int i = 0; i < 64; ++i)
+    {
+      url.insert(5, "./");
+      assert(lldplay_probe(url.c_str(), onProbe, &probe, 60000));
+      assert(!probe.cached);
+    }
+
+    assert(lldplay_probe(url.c_str(), onProbe, &probe, 60000));
+    assert(probe.cached);
+    assert(lldplay_probe("data/test.mp4", onProbe, &probe, 60000));
+    assert(!probe.cached);
+
+    assert(!lldplay_probe("data/I_dont_exist.mp4", onProbe, &probe, 0));
+    assert(!lldplay_probe("http://127.0.0.1:1/I_dont_exist.mpd", onProbe, &probe, 0));
+  }
+
+  // malformed local file: 4G samples of 1 byte announced in a 100-byte file
+  {
+    static const uint8_t stsz[] =
+    {
+      0, 0, 0, 20, 's', 't', 's', 'z',
+      0, 0, 0, 0, // version + flags
+      0, 0, 0, 1, // constant sample size
+      0xff, 0xff, 0xff, 0xff, // sample count
+    };
+
+    vector<uint8_t> file;
+    auto addBoxHeader = [&] (const char* type, size_t payloadSize)
+      {
+        auto const size = (uint32_t)(8 + payloadSize);
+        uint8_t const header[] = { uint8_t(size >> 24), uint8_t(size >> 16), uint8_t(size >> 8), uint8_t(size), uint8_t(type[0]), uint8_t(type[1]), uint8_t(type[2]), uint8_t(type[3]) };
+        file.insert(file.end(), header, header + sizeof header);
+      };
+
+    addBoxHeader("moov", 8 * 4 + sizeof stsz);
+    addBoxHeader("trak", 8 * 3 + sizeof stsz);
+    addBoxHeader("mdia", 8 * 2 + sizeof stsz);
+    addBoxHeader("minf", 8 + sizeof stsz);
+    addBoxHeader("stbl", sizeof stsz);
+    file.insert(file.end(), stsz, stsz + sizeof stsz);
+
+    auto f = fopen("malformed.mp4", "wb");
+    assert(f);
+    fwrite(file.data(), 1, file.size(), f);
+    fclose(f);
+
+    auto onProbe = [] (void*, const StreamDesc*, int, const ProbeInfo*) {};
+    assert(!lldplay_probe("malformed.mp4", onProbe, nullptr, 0));
+    remove("malformed.mp4");
+  }
+
+  // jitter buffer
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    PlayoutClock clock {};
+    assert(!lldplay_get_playout_clock(pipeline, &clock)); // disabled
+    assert(!lldplay_set_jitter_buffer(pipeline, 50, 10));
+    assert(lldplay_set_jitter_buffer(pipeline, 50, 200));
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+
+    vector<uint8_t> buffer(1024 * 1024);
+    assert(grabWithTimeout(pipeline, 0, buffer, nullptr, 1000));
+    assert(lldplay_get_playout_clock(pipeline, &clock));
+    assert(clock.delayMs >= 50 && clock.delayMs <= 200);
+    lldplay_destroy(pipeline);
+  }
+
+  // independent consumers
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    auto const monitor = lldplay_add_consumer(pipeline, 1000);
+    auto const slow = lldplay_add_consumer(pipeline, 2);
+    assert(monitor > 0 && slow > 0 && monitor != slow);
+    assert(lldplay_add_consumer(pipeline, 0) == -1);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+
+    vector<uint8_t> buffer(1024 * 1024);
+
+    for(int i = 0; i < 5; ++i)
+      assert(grabWithTimeout(pipeline, 0, buffer, nullptr, 1000));
+
+    // the frames read by the default consumer are still there for the others
+    for(int i = 0; i < 5; ++i)
+      assert(lldplay_consumer_grab_frame(pipeline, monitor, 0, buffer.data(), buffer.size(), nullptr));
+
+    ConsumerStats stats {};
+    assert(lldplay_get_consumer_stats(pipeline, monitor, 0, &stats));
+    assert(stats.framesRead == 5);
+    assert(stats.framesDropped == 0);
+
+    assert(lldplay_get_consumer_stats(pipeline, slow, 0, &stats));
+    assert(stats.framesDropped >= 3);
+    assert(stats.lag <= 2);
+
+    assert(lldplay_remove_consumer(pipeline, slow));
+    assert(!lldplay_remove_consumer(pipeline, slow));
+    assert(lldplay_remove_consumer(pipeline, 0));
+    assert(lldplay_grab_frame(pipeline, 0, buffer.data(), buffer.size(), nullptr) == 0);
+    lldplay_destroy(pipeline);
+  }
+
+  // pause/resume
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(!lldplay_pause(pipeline));
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    assert(lldplay_pause(pipeline));
+    assert(lldplay_pause(pipeline));
+    assert(!lldplay_remove_source(pipeline, 0)); // not while paused
+
+    vector<uint8_t> buffer(1024 * 1024);
+    this_thread::sleep_for(chrono::milliseconds(300));
+    assert(lldplay_grab_frame(pipeline, 0, buffer.data(), buffer.size(), nullptr) == 0);
+
+    assert(!lldplay_resume(pipeline, 42));
+    assert(lldplay_resume(pipeline, LLDPLAY_RESUME_CONTINUE));
+    assert(grabWithTimeout(pipeline, 0, buffer, nullptr, 1000));
+    lldplay_destroy(pipeline);
+  }
+
+  // bounded-time stop
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(lldplay_play(pipeline, "data/test.mp4"));
+    this_thread::sleep_for(chrono::milliseconds(100));
+
+    auto const start = chrono::steady_clock::now();
+    assert(lldplay_stop(pipeline, 1000));
+    assert(lldplay_stop(pipeline, 0)); // idempotent
+    assert(chrono::steady_clock::now() - start < chrono::milliseconds(1000));
+
+    assert(lldplay_add_source(pipeline, "data/test.mp4") == -1);
+    lldplay_destroy(pipeline);
+
+    // nothing left running in the background: the library can be unloaded
+    assert(lldplay_wait_teardown(0));
+  }
+
+  // only local files are seekable
+  {
+    auto pipeline = lldplay_create("MyPipeline", nullptr, 2);
+    assert(!lldplay_seek(pipeline, 0));
+    lldplay_destroy(pipeline);
+  }
+
   return 0;
 }